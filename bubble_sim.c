@@ -1,17 +1,34 @@
 #include <furi.h>
+#include <furi_hal.h>
 #include <gui/gui.h>
 #include <input/input.h>
 #include <math.h>
+#include <stdarg.h>
 #include <string.h>
 #include <stdio.h>
 #include <storage/storage.h>
 #include <toolbox/path.h>
 
+#define TAG "BubbleSim"
+
 #define SCREEN_W 128
 #define SCREEN_H 64
+#define FB_SIZE (SCREEN_W * SCREEN_H / 8) // 1-bit frame, bytes
 
 // Config file in /ext/apps_data/<appid>/bubble.cfg
 #define BUBBLE_CFG_PATH APP_DATA_PATH("bubble.cfg")
+// Config of the second world in compare mode
+#define BUBBLE_CFG_B_PATH APP_DATA_PATH("bubble_b.cfg")
+// One record appended per session, see bubble_save_stats()
+#define BUBBLE_STATS_PATH APP_DATA_PATH("stats.txt")
+// Simulation recording, see the Recording section and tools/bubble_trace.c
+#define BUBBLE_REC_PATH APP_DATA_PATH("rec.bsr")
+// Benchmark scenarios shipped with the app (fap_file_assets) and their results
+#define BUBBLE_BENCH_DIR APP_ASSETS_PATH("scenarios")
+#define BUBBLE_BENCH_PATH APP_DATA_PATH("bench.txt")
+#define BUBBLE_FEEDBACK_PATH APP_DATA_PATH("feedback.txt")
+// Broadphase picked per config hash by the auto-tuner
+#define BUBBLE_TUNE_PATH APP_DATA_PATH("tune.bin")
 
 // --- Tunable configuration limits -----------------------------------------
 
@@ -27,6 +44,8 @@ static const float BUBBLE_MAX_POP          = 1.0f;
 
 // --- Physics ----------------------------------------------------------------
 
+#define PHYSICS_MAX_GROUPS 3
+
 typedef struct {
     float x;
     float y;
@@ -88,24 +107,403 @@ static float rng_next_float01(SimpleRng* rng) {
     return (float)(rng_next(rng) & 0x00FFFFFFu) / (float)0x01000000u;
 }
 
+// --- Sampling profiler ------------------------------------------------------
+//
+// Build with BUBBLE_PROFILER defined (see application.fam) to profile on
+// device. TIM17 interrupts PROF_SAMPLE_HZ times a second. The handler takes
+// the exception frame the core pushed onto the interrupted task's stack
+// (PSP): its PC and LR, then up to PROF_STACK_WORDS words further up that
+// look like Thumb return addresses (odd, in flash or RAM, where the .fap
+// is loaded). Nothing in the app is marked, so time in canvas_*, libm,
+// furi and storage calls shows up under its own name. Samples go into a
+// preallocated ring; a writer thread streams it to profile.bin, which
+// tools/bubble_prof.c symbolizes against the .fap ELF (and optionally the
+// firmware ELF) into folded stacks for flamegraph.pl.
+//
+// The PC is exact; callers come from the stack scan, so stale return
+// addresses can add a frame that isn't live. Every thread is sampled, the
+// GUI, storage and idle threads as well as the app. A tick that lands in
+// another interrupt, or in a critical section (which masks this one until
+// it ends), can't see a thread frame and is counted as [interrupt].
+
+#ifdef BUBBLE_PROFILER
+
+#include <stm32wbxx_ll_tim.h>
+
+#define PROF_SAMPLE_HZ 250     // ~72 B per sample to SD, 18 KB/s
+#define PROF_STACK_WORDS 16    // return addresses kept per sample
+#define PROF_SCAN_WORDS 256    // stack words the handler looks through
+#define PROF_RING 128          // samples, half a second at PROF_SAMPLE_HZ
+#define PROF_MAX_THREADS 16    // named threads; later ones share one record
+#define PROF_DRAIN_MS 100      // writer period
+#define PROF_FLASH_LO 0x08000000u
+#define PROF_FLASH_HI 0x08100000u
+#define PROF_RAM_LO 0x20000000u
+#define PROF_RAM_HI 0x20030000u // SRAM1; SRAM2 is partly the radio core's
+#define BUBBLE_PROFILE_PATH APP_DATA_PATH("profile.bin")
+
+// Profile file format, read by tools/bubble_prof.c (keep the two in sync).
+// A ProfFileHeader, then records, each starting with its type byte: a
+// ProfThreadRecord before the first sample of each thread, and ProfSamples.
+// Little-endian, no padding.
+
+#define PROF_MAGIC 0x46525042u // "BPRF"
+#define PROF_VERSION 1
+#define PROF_REC_THREAD 'T'
+#define PROF_REC_SAMPLE 'S'
+#define PROF_THREAD_OTHER 0xFE // table full
+#define PROF_THREAD_IRQ 0xFF   // no thread frame to read, see above
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size; // sizeof(ProfFileHeader), readers skip the rest
+    uint32_t sample_hz;
+    uint32_t anchor;      // run-time address of bubble_sim_app, Thumb bit clear
+    uint16_t stack_words; // PROF_STACK_WORDS, the size of ProfSample.stack
+    uint16_t reserved;
+} ProfFileHeader;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type; // PROF_REC_THREAD
+    uint8_t index;
+    char name[14]; // NUL-padded, unterminated at full length
+} ProfThreadRecord;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;   // PROF_REC_SAMPLE
+    uint8_t thread; // ProfThreadRecord index, or PROF_THREAD_*
+    uint8_t words;  // valid entries in stack, innermost first
+    uint8_t reserved;
+    uint32_t pc;
+    uint32_t lr;
+    uint32_t stack[PROF_STACK_WORDS];
+} ProfSample;
+
+typedef struct {
+    ProfSample ring[PROF_RING];
+    volatile uint32_t head; // written by the handler
+    volatile uint32_t tail; // written by the writer thread
+    FuriThreadId threads[PROF_MAX_THREADS];
+    volatile uint8_t thread_count; // handler appends, writer names
+    uint8_t threads_written;
+    volatile bool stop;
+    uint32_t samples;
+    uint32_t dropped; // ring full
+    uint32_t irq;     // samples counted as [interrupt]
+    uint32_t bytes;
+    FuriThread* writer;
+    File* file;
+} Profiler;
+
+static Profiler prof;
+
+int32_t bubble_sim_app(void* p);
+
+static inline bool prof_code_addr(uint32_t w) {
+    return (w & 1u) && ((w >= PROF_FLASH_LO && w < PROF_FLASH_HI) ||
+                        (w >= PROF_RAM_LO && w < PROF_RAM_HI));
+}
+
+static uint8_t prof_thread_index(FuriThreadId id) {
+    uint8_t count = prof.thread_count;
+    for(uint8_t i = 0; i < count; i++) {
+        if(prof.threads[i] == id) return i;
+    }
+    if(count == PROF_MAX_THREADS) return PROF_THREAD_OTHER;
+    prof.threads[count] = id;
+    __atomic_store_n(&prof.thread_count, count + 1, __ATOMIC_RELEASE);
+    return count;
+}
+
+static void prof_sample_isr(void* context) {
+    UNUSED(context);
+    if(!LL_TIM_IsActiveFlag_UPDATE(TIM17)) return;
+    LL_TIM_ClearFlag_UPDATE(TIM17);
+
+    uint32_t head = prof.head;
+    if(head - __atomic_load_n(&prof.tail, __ATOMIC_ACQUIRE) == PROF_RING) {
+        prof.dropped++;
+        return;
+    }
+    ProfSample* s = &prof.ring[head % PROF_RING];
+    s->type = PROF_REC_SAMPLE;
+    s->words = 0;
+    s->reserved = 0;
+
+    // RETTOBASE: this is the only active exception, so it interrupted a
+    // thread and the frame on PSP is that thread's: r0-r3, r12, lr, pc, xpsr
+    const uint32_t* sp = (const uint32_t*)(uintptr_t)__get_PSP();
+    uint32_t at = (uint32_t)(uintptr_t)sp;
+    if(!(SCB->ICSR & SCB_ICSR_RETTOBASE_Msk) || at < PROF_RAM_LO ||
+       at + 8 * sizeof(uint32_t) > PROF_RAM_HI) {
+        s->thread = PROF_THREAD_IRQ;
+        s->pc = s->lr = 0;
+        prof.irq++;
+    } else {
+        s->thread = prof_thread_index(furi_thread_get_current_id());
+        s->lr = sp[5];
+        s->pc = sp[6];
+        // Past the frame; a lazily stacked FPU frame just scans as data
+        size_t end = (PROF_RAM_HI - at) / sizeof(uint32_t);
+        if(end > 8 + PROF_SCAN_WORDS) end = 8 + PROF_SCAN_WORDS;
+        for(size_t i = 8; i < end && s->words < PROF_STACK_WORDS; i++) {
+            if(prof_code_addr(sp[i])) s->stack[s->words++] = sp[i];
+        }
+    }
+    prof.samples++;
+    __atomic_store_n(&prof.head, head + 1, __ATOMIC_RELEASE);
+}
+
+static void prof_write(const void* data, size_t size) {
+    prof.bytes += (uint32_t)storage_file_write(prof.file, data, size);
+}
+
+// Thread records first: every sample up to head names a thread that was
+// in the table by then. Names are read here, as furi won't in an ISR.
+static void prof_drain(void) {
+    uint32_t head = __atomic_load_n(&prof.head, __ATOMIC_ACQUIRE);
+    uint8_t threads = __atomic_load_n(&prof.thread_count, __ATOMIC_ACQUIRE);
+    for(; prof.threads_written < threads; prof.threads_written++) {
+        ProfThreadRecord rec = {.type = PROF_REC_THREAD, .index = prof.threads_written};
+        const char* name = furi_thread_get_name(prof.threads[prof.threads_written]);
+        strncpy(rec.name, name ? name : "thread", sizeof(rec.name));
+        prof_write(&rec, sizeof(rec));
+    }
+    for(uint32_t tail = prof.tail; tail != head; tail++) {
+        prof_write(&prof.ring[tail % PROF_RING], sizeof(ProfSample));
+        __atomic_store_n(&prof.tail, tail + 1, __ATOMIC_RELEASE);
+    }
+}
+
+static int32_t prof_writer(void* context) {
+    UNUSED(context);
+    while(!prof.stop) {
+        furi_delay_ms(PROF_DRAIN_MS);
+        prof_drain();
+    }
+    prof_drain();
+    return 0;
+}
+
+static void prof_start(void) {
+    memset(&prof, 0, sizeof(prof));
+    if(furi_hal_bus_is_enabled(FuriHalBusTIM17)) {
+        FURI_LOG_W(TAG, "profiler: TIM17 is in use, not sampling");
+        return;
+    }
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_common_mkdir(storage, APP_DATA_PATH(""));
+    prof.file = storage_file_alloc(storage);
+    if(!storage_file_open(prof.file, BUBBLE_PROFILE_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        storage_file_free(prof.file);
+        prof.file = NULL;
+        furi_record_close(RECORD_STORAGE);
+        return;
+    }
+    ProfFileHeader header = {
+        .magic = PROF_MAGIC,
+        .version = PROF_VERSION,
+        .header_size = sizeof(ProfFileHeader),
+        .sample_hz = PROF_SAMPLE_HZ,
+        .anchor = (uint32_t)(uintptr_t)bubble_sim_app & ~1u,
+        .stack_words = PROF_STACK_WORDS,
+    };
+    prof_write(&header, sizeof(header));
+
+    // Above the app thread, so a busy step can't starve it into dropping
+    prof.writer = furi_thread_alloc_ex("BubbleProf", 2 * 1024, prof_writer, NULL);
+    furi_thread_set_priority(prof.writer, FuriThreadPriorityHigh);
+    furi_thread_start(prof.writer);
+
+    // 1 MHz counter, one update interrupt per sample
+    furi_hal_bus_enable(FuriHalBusTIM17);
+    LL_TIM_SetPrescaler(TIM17, furi_hal_cortex_instructions_per_microsecond() - 1);
+    LL_TIM_SetAutoReload(TIM17, 1000000u / PROF_SAMPLE_HZ - 1);
+    LL_TIM_GenerateEvent_UPDATE(TIM17);
+    LL_TIM_ClearFlag_UPDATE(TIM17);
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTim1TrgComTim17, prof_sample_isr, NULL);
+    LL_TIM_EnableIT_UPDATE(TIM17);
+    LL_TIM_EnableCounter(TIM17);
+}
+
+static void prof_stop_and_save(void) {
+    if(!prof.file) return;
+    LL_TIM_DisableCounter(TIM17);
+    LL_TIM_DisableIT_UPDATE(TIM17);
+    furi_hal_interrupt_set_isr(FuriHalInterruptIdTim1TrgComTim17, NULL, NULL);
+    furi_hal_bus_disable(FuriHalBusTIM17);
+
+    prof.stop = true;
+    furi_thread_join(prof.writer);
+    furi_thread_free(prof.writer);
+
+    storage_file_sync(prof.file);
+    storage_file_close(prof.file);
+    storage_file_free(prof.file);
+    prof.file = NULL;
+    furi_record_close(RECORD_STORAGE);
+
+    FURI_LOG_I(
+        TAG,
+        "profiler: %lu samples, %lu in interrupts, %lu dropped, %lu bytes",
+        (unsigned long)prof.samples,
+        (unsigned long)prof.irq,
+        (unsigned long)prof.dropped,
+        (unsigned long)prof.bytes);
+}
+
+#endif
+
 // Pop animation length in frames
 #define POP_ANIM_FRAMES 8
 
-// Physics step now has access to RNG for pop chance
-static void physics_step(
+// --- Statistics -------------------------------------------------------------
+
+// Plain counters indexed by body group; the physics loops only ever add to
+// them, so keeping them costs an increment per event and no extra branches.
+typedef struct {
+    uint32_t collisions[PHYSICS_MAX_GROUPS];      // per body involved in a contact
+    uint32_t pops[PHYSICS_MAX_GROUPS];            // popped on collision
+    uint32_t respawns_top[PHYSICS_MAX_GROUPS];    // floated off the top
+    uint32_t respawns_popped[PHYSICS_MAX_GROUPS]; // respawned after the pop animation
+    uint32_t cooldown_frames[PHYSICS_MAX_GROUPS]; // body-frames spent in spawn cooldown
+    uint32_t live_frames[PHYSICS_MAX_GROUPS];     // body-frames not popped or animating
+    uint32_t steps;
+    uint32_t pair_tests;                          // pairs that reached the narrow phase
+    uint32_t chain_pops;                          // popped by another pop's blast
+    uint32_t blast_queries;
+    uint64_t blast_cycles;
+    uint64_t physics_cycles;
+} PhysicsStats;
+
+// Target for callers that don't care, so the loops never test for NULL
+static PhysicsStats stats_sink;
+
+// --- Event bus --------------------------------------------------------------
+//
+// The physics loops report what happened (pops, impacts, respawns, wall
+// hits) as 8-byte events in a fixed ring, and the app hands them to
+// subscribers once the step is over, so nothing in an inner loop calls out.
+// While no subscriber wants a kind, emitting it is a mask test. Producer and
+// consumer are both the app thread; a full ring drops new events and counts
+// them.
+
+#define SIM_BUS_CAPACITY 256 // events, power of two
+#define SIM_BUS_MAX_SUBSCRIBERS 8
+
+typedef enum {
+    SimEventPop = 0,
+    SimEventContact, // an approaching pair bounced
+    SimEventRespawn,
+    SimEventWall, // hit a side wall moving into it
+    SimEventKindCountEnum,
+} SimEventKind;
+
+#define SIM_EVENT_BIT(kind) (1u << (kind))
+#define SIM_EVENT_ALL ((1u << SimEventKindCountEnum) - 1)
+
+typedef struct {
+    uint8_t kind;  // SimEventKind
+    uint8_t body;  // index from the bus base
+    uint8_t other; // contact: the other body; chain pop: the one that blew
+    uint8_t group; // of body
+    int16_t x;     // body position, px
+    int16_t y;
+} SimEvent;
+
+typedef void (*SimEventCallback)(const SimEvent* event, void* context);
+
+typedef struct {
+    SimEventCallback callback;
+    void* context;
+    uint8_t mask;
+} SimSubscriber;
+
+typedef struct {
+    SimEvent ring[SIM_BUS_CAPACITY];
+    uint32_t head; // emitted
+    uint32_t tail; // dispatched
+    uint32_t dropped;
+    uint32_t dispatched;
+    uint8_t mask; // kinds someone subscribed to
+    const PhysicsBody* base;
+    SimSubscriber subscribers[SIM_BUS_MAX_SUBSCRIBERS];
+    size_t subscriber_count;
+} SimBus;
+
+// The physics loops emit here; the app subscribes and dispatches
+static SimBus sim_bus;
+
+static inline void sim_emit(SimEventKind kind, const PhysicsBody* b, const PhysicsBody* other) {
+    SimBus* bus = &sim_bus;
+    if(!(bus->mask & SIM_EVENT_BIT(kind))) return;
+    if(bus->head - bus->tail == SIM_BUS_CAPACITY) {
+        bus->dropped++;
+        return;
+    }
+    SimEvent* ev = &bus->ring[bus->head++ & (SIM_BUS_CAPACITY - 1)];
+    ev->kind = (uint8_t)kind;
+    ev->body = (uint8_t)(b - bus->base);
+    ev->other = (uint8_t)((other ? other : b) - bus->base);
+    ev->group = (uint8_t)b->group;
+    ev->x = (int16_t)b->x;
+    ev->y = (int16_t)b->y;
+}
+
+static void sim_bus_update_mask(SimBus* bus) {
+    bus->mask = 0;
+    for(size_t i = 0; i < bus->subscriber_count; i++) {
+        bus->mask |= bus->subscribers[i].mask;
+    }
+}
+
+// Ask for the kinds in mask (SIM_EVENT_BIT()s). False if the table is full.
+static bool sim_bus_subscribe(SimBus* bus, uint8_t mask, SimEventCallback callback, void* context) {
+    if(bus->subscriber_count == SIM_BUS_MAX_SUBSCRIBERS) return false;
+    SimSubscriber* sub = &bus->subscribers[bus->subscriber_count++];
+    sub->callback = callback;
+    sub->context = context;
+    sub->mask = mask;
+    sim_bus_update_mask(bus);
+    return true;
+}
+
+static void sim_bus_unsubscribe(SimBus* bus, SimEventCallback callback, void* context) {
+    for(size_t i = 0; i < bus->subscriber_count; i++) {
+        SimSubscriber* sub = &bus->subscribers[i];
+        if(sub->callback != callback || sub->context != context) continue;
+        *sub = bus->subscribers[--bus->subscriber_count];
+        break;
+    }
+    sim_bus_update_mask(bus);
+}
+
+// Hand every pending event to its subscribers, in emission order
+static void sim_bus_dispatch(SimBus* bus) {
+    while(bus->tail != bus->head) {
+        const SimEvent* ev = &bus->ring[bus->tail++ & (SIM_BUS_CAPACITY - 1)];
+        for(size_t i = 0; i < bus->subscriber_count; i++) {
+            const SimSubscriber* sub = &bus->subscribers[i];
+            if(sub->mask & SIM_EVENT_BIT(ev->kind)) sub->callback(ev, sub->context);
+        }
+        bus->dispatched++;
+    }
+}
+
+// Integrate velocities and positions, bounce off the side walls and tick
+// spawn cooldowns. Shared by every stepping mode.
+static void physics_integrate(
     PhysicsBody* bodies,
     size_t count,
     float dt,
     float gravity_y,
     const WorldBounds* bounds,
-    SimpleRng* rng
+    PhysicsStats* stats
 ) {
-    if(dt <= 0.0f) return;
-    if(!bodies || count == 0) return;
-
     const float TWO_PI = 6.2831853f;
 
-    // 1) Integrate velocities and positions
     for(size_t i = 0; i < count; i++) {
         PhysicsBody* b = &bodies[i];
 
@@ -135,20 +533,191 @@ static void physics_step(
             float r = b->radius;
             if(b->x - r < bounds->min_x) {
                 b->x = bounds->min_x + r;
-                if(b->vx < 0.0f) b->vx = -b->vx * b->restitution;
+                if(b->vx < 0.0f) {
+                    b->vx = -b->vx * b->restitution;
+                    sim_emit(SimEventWall, b, NULL);
+                }
             } else if(b->x + r > bounds->max_x) {
                 b->x = bounds->max_x - r;
-                if(b->vx > 0.0f) b->vx = -b->vx * b->restitution;
+                if(b->vx > 0.0f) {
+                    b->vx = -b->vx * b->restitution;
+                    sim_emit(SimEventWall, b, NULL);
+                }
             }
         }
 
         // Decrement spawn cooldown
+        stats->live_frames[b->group]++;
+        stats->cooldown_frames[b->group] += (b->spawn_cooldown > 0);
         if(b->spawn_cooldown > 0) {
             b->spawn_cooldown--;
         }
     }
+}
+
+// Circle–circle contact for one pair: positional correction, bounce and pop
+// roll. Returns true if the pair was overlapping and got pushed apart.
+static bool physics_resolve_pair(
+    PhysicsBody* a,
+    PhysicsBody* b,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(a->inv_mass <= 0.0f && b->inv_mass <= 0.0f) return false; // both static
+    stats->pair_tests++;
+
+    float dx = b->x - a->x;
+    float dy = b->y - a->y;
+    float r_sum = a->radius + b->radius;
+    float dist2 = ph_len2(dx, dy);
+
+    if(dist2 <= 0.00001f) {
+        // prevent NaNs – give them a tiny separation
+        dx = 0.001f;
+        dy = 0.0f;
+        dist2 = ph_len2(dx, dy);
+    }
+
+    if(dist2 > r_sum * r_sum) return false; // no overlap
+
+    float dist = sqrtf(dist2);
+    float penetration = r_sum - dist;
+    if(penetration <= 0.0f) return false;
+
+    // Normal from a -> b
+    float nx = dx / dist;
+    float ny = dy / dist;
+
+    float inv_ma = a->inv_mass;
+    float inv_mb = b->inv_mass;
+    float inv_sum = inv_ma + inv_mb;
+
+    // Positional correction proportional to inverse mass
+    float move_a = (inv_ma / inv_sum) * penetration;
+    float move_b = (inv_mb / inv_sum) * penetration;
+
+    if(inv_ma > 0.0f) {
+        a->x -= nx * move_a;
+        a->y -= ny * move_a;
+    }
+    if(inv_mb > 0.0f) {
+        b->x += nx * move_b;
+        b->y += ny * move_b;
+    }
+
+    stats->collisions[a->group]++;
+    stats->collisions[b->group]++;
+
+    // Relative velocity along normal
+    float rvx = b->vx - a->vx;
+    float rvy = b->vy - a->vy;
+    float vel_norm = rvx * nx + rvy * ny;
+
+    // if separating, skip bounce
+    if(vel_norm > 0.0f) return true;
+    sim_emit(SimEventContact, a, b);
+
+    // Combine restitution
+    float e = (a->restitution + b->restitution) * 0.5f;
+
+    // Impulse scalar
+    float j_impulse = -(1.0f + e) * vel_norm;
+    j_impulse /= inv_sum;
+
+    float ix = j_impulse * nx;
+    float iy = j_impulse * ny;
+
+    if(inv_ma > 0.0f) {
+        a->vx -= ix * inv_ma;
+        a->vy -= iy * inv_ma;
+    }
+    if(inv_mb > 0.0f) {
+        b->vx += ix * inv_mb;
+        b->vy += iy * inv_mb;
+    }
+
+    // POP logic: chance-based removal on collision
+    if(rng) {
+        float avg_pop = (a->pop_chance + b->pop_chance) * 0.5f;
+        if(avg_pop > 0.0f && rng_next_float01(rng) < avg_pop) {
+            // Pop the smaller bubble (feels a bit more natural)
+            PhysicsBody* victim = (a->radius <= b->radius) ? a : b;
+            victim->popped = true;
+            victim->pop_anim_timer = POP_ANIM_FRAMES;
+            stats->pops[victim->group]++;
+            sim_emit(SimEventPop, victim, victim == a ? b : a);
+        }
+    }
+
+    return true;
+}
+
+// Hot flags for the pair loops. Rather than re-testing every j's popped,
+// animating, cooldown and on-band state once per i, a pre-pass builds two
+// masks per step, bit i for body i, and a row walks only the set bits of its
+// columns with count-trailing-zeros. A resolve that moves or pops a body
+// refreshes its bits, so the result matches the per-pair tests exactly.
+
+#define PAIR_FLAG_BODIES 64 // bits in the masks
+
+typedef struct {
+    uint64_t collidable; // not popped, animating or in spawn cooldown
+    uint64_t visible;    // touches the collidable band
+    uint64_t dynamic;    // inv_mass > 0; two static bodies never need a test
+} PairFlags;
+
+static void pair_flags_build(
+    PairFlags* f,
+    const PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds
+) {
+    f->collidable = 0;
+    f->visible = 0;
+    f->dynamic = 0;
+    for(size_t i = 0; i < count; i++) {
+        const PhysicsBody* b = &bodies[i];
+        if(b->popped || b->pop_anim_timer > 0 || b->spawn_cooldown > 0) continue;
+        f->collidable |= 1ull << i;
+        if(b->inv_mass > 0.0f) f->dynamic |= 1ull << i;
+        if(body_is_visible_vertical(b, bounds)) f->visible |= 1ull << i;
+    }
+}
+
+// Body i was moved or popped by a resolve
+static inline void pair_flags_touch(
+    PairFlags* f,
+    const PhysicsBody* b,
+    size_t i,
+    const WorldBounds* bounds
+) {
+    uint64_t bit = 1ull << i;
+    if(b->popped || b->pop_anim_timer > 0) f->collidable &= ~bit;
+    if(body_is_visible_vertical(b, bounds)) {
+        f->visible |= bit;
+    } else {
+        f->visible &= ~bit;
+    }
+}
+
+// Bodies j > i that body i is tested against; a pair needs one of the two
+// on the band. Empty when i itself can't collide.
+static inline uint64_t pair_flags_row(const PairFlags* f, size_t i) {
+    uint64_t bit = 1ull << i;
+    if(!(f->collidable & bit)) return 0;
+    uint64_t cols = f->collidable & ~(bit | (bit - 1));
+    if(!(f->dynamic & bit)) cols &= f->dynamic;
+    return (f->visible & bit) ? cols : cols & f->visible;
+}
 
-    // 2) Naive O(n^2) circle–circle collision resolution
+// Per-pair filters in the loop itself; worlds wider than the flag masks
+static void physics_collide_scalar(
+    PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
     for(size_t i = 0; i < count; i++) {
         PhysicsBody* a = &bodies[i];
         if(a->popped || a->pop_anim_timer > 0) continue; // skip popped / animating
@@ -167,620 +736,6471 @@ static void physics_step(
             // Skip collisions if either body is in spawn cooldown
             if(a->spawn_cooldown > 0 || b->spawn_cooldown > 0) continue;
 
-            float dx = b->x - a->x;
-            float dy = b->y - a->y;
-            float r_sum = a->radius + b->radius;
-            float dist2 = ph_len2(dx, dy);
-
-            if(dist2 <= 0.00001f) {
-                // prevent NaNs – give them a tiny separation
-                dx = 0.001f;
-                dy = 0.0f;
-                dist2 = ph_len2(dx, dy);
-            }
-
-            if(dist2 > r_sum * r_sum) continue; // no overlap
-
-            float dist = sqrtf(dist2);
-            float penetration = r_sum - dist;
-            if(penetration <= 0.0f) continue;
-
-            // Normal from a -> b
-            float nx = dx / dist;
-            float ny = dy / dist;
+            physics_resolve_pair(a, b, rng, stats);
+        }
+    }
+}
 
-            float inv_ma = a->inv_mass;
-            float inv_mb = b->inv_mass;
-            float inv_sum = inv_ma + inv_mb;
-            if(inv_sum <= 0.0f) {
-                // both static
-                continue;
-            }
+// Naive O(n^2) circle–circle collision resolution
+static void physics_collide_naive(
+    PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds,
+    const uint64_t* near, // optional: per body, the bodies it may touch
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(count > PAIR_FLAG_BODIES) {
+        physics_collide_scalar(bodies, count, bounds, rng, stats);
+        return;
+    }
 
-            // Positional correction proportional to inverse mass
-            float move_a = (inv_ma / inv_sum) * penetration;
-            float move_b = (inv_mb / inv_sum) * penetration;
+    PairFlags flags;
+    pair_flags_build(&flags, bodies, count, bounds);
 
-            if(inv_ma > 0.0f) {
-                a->x -= nx * move_a;
-                a->y -= ny * move_a;
-            }
-            if(inv_mb > 0.0f) {
-                b->x += nx * move_b;
-                b->y += ny * move_b;
+    for(size_t i = 0; i < count; i++) {
+        PhysicsBody* a = &bodies[i];
+        uint64_t row = pair_flags_row(&flags, i);
+        if(near) row &= near[i];
+        for(uint64_t cols = row; cols; cols &= cols - 1) {
+            size_t j = (size_t)__builtin_ctzll(cols);
+            if(physics_resolve_pair(a, &bodies[j], rng, stats)) {
+                pair_flags_touch(&flags, a, i, bounds);
+                pair_flags_touch(&flags, &bodies[j], j, bounds);
             }
+        }
+    }
+}
 
-            // Relative velocity along normal
-            float rvx = b->vx - a->vx;
-            float rvy = b->vy - a->vy;
-            float vel_norm = rvx * nx + rvy * ny;
+// Physics step now has access to RNG for pop chance
+static void physics_step(
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    float gravity_y,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(dt <= 0.0f) return;
+    if(!bodies || count == 0) return;
+    if(!stats) stats = &stats_sink;
 
-            // if separating, skip bounce
-            if(vel_norm > 0.0f) continue;
+    // 1) Integrate velocities and positions
+    physics_integrate(bodies, count, dt, gravity_y, bounds, stats);
 
-            // Combine restitution
-            float e = (a->restitution + b->restitution) * 0.5f;
+    // 2) Pairwise contacts
+    physics_collide_naive(bodies, count, bounds, NULL, rng, stats);
+}
 
-            // Impulse scalar
-            float j_impulse = -(1.0f + e) * vel_norm;
-            j_impulse /= inv_sum;
+// --- Event-driven stepping --------------------------------------------------
+//
+// Sparse scenes (a few big slow bubbles) almost never touch, yet stepping pays
+// for the full pair loop every frame. Here each body carries the earliest time
+// it could possibly touch anything, kept in a min-heap; only bodies whose time
+// has come get their row of pairs checked. Times are conservative: gap divided
+// by the largest closing speed (velocity plus wobble amplitude), which holds as
+// long as nothing accelerates – wall bounces only ever shrink |v|. Anything
+// that moves a body outside the step (contacts, respawns) reschedules it.
 
-            float ix = j_impulse * nx;
-            float iy = j_impulse * ny;
+#define TOI_MAX_BODIES 64
+#define TOI_HORIZON 2.0f       // never schedule further out than this (s)
+#define TOI_BACKOFF_FRAMES 30  // frames to stay on stepping after a dense frame
 
-            if(inv_ma > 0.0f) {
-                a->vx -= ix * inv_ma;
-                a->vy -= iy * inv_ma;
-            }
-            if(inv_mb > 0.0f) {
-                b->vx += ix * inv_mb;
-                b->vy += iy * inv_mb;
-            }
+typedef struct {
+    float next_time[TOI_MAX_BODIES]; // earliest possible contact per body
+    uint8_t heap[TOI_MAX_BODIES];    // body indices, min-heap on next_time
+    uint8_t heap_pos[TOI_MAX_BODIES];
+    size_t count;
+    float now; // sim clock (s), reset on rebuild
+    bool valid;
+    int backoff;
+
+    // Last frame, for the HUD
+    uint16_t last_events;
+    bool last_stepped;
+} ToiQueue;
+
+static void toi_heap_swap(ToiQueue* q, size_t i, size_t j) {
+    uint8_t t = q->heap[i];
+    q->heap[i] = q->heap[j];
+    q->heap[j] = t;
+    q->heap_pos[q->heap[i]] = (uint8_t)i;
+    q->heap_pos[q->heap[j]] = (uint8_t)j;
+}
 
-            // POP logic: chance-based removal on collision
-            if(rng) {
-                float avg_pop = (a->pop_chance + b->pop_chance) * 0.5f;
-                if(avg_pop > 0.0f && rng_next_float01(rng) < avg_pop) {
-                    // Pop the smaller bubble (feels a bit more natural)
-                    PhysicsBody* victim = (a->radius <= b->radius) ? a : b;
-                    victim->popped = true;
-                    victim->pop_anim_timer = POP_ANIM_FRAMES;
-                }
-            }
-        }
+static void toi_heap_fix(ToiQueue* q, size_t i) {
+    // sift up
+    while(i > 0) {
+        size_t parent = (i - 1) / 2;
+        if(q->next_time[q->heap[parent]] <= q->next_time[q->heap[i]]) break;
+        toi_heap_swap(q, i, parent);
+        i = parent;
+    }
+    // sift down
+    for(;;) {
+        size_t l = i * 2 + 1;
+        size_t r = l + 1;
+        size_t m = i;
+        if(l < q->count && q->next_time[q->heap[l]] < q->next_time[q->heap[m]]) m = l;
+        if(r < q->count && q->next_time[q->heap[r]] < q->next_time[q->heap[m]]) m = r;
+        if(m == i) break;
+        toi_heap_swap(q, i, m);
+        i = m;
     }
 }
 
-// --- Bubble sim app ---------------------------------------------------------
-
-#define MAX_BODIES 48
-#define GROUP_COUNT 3
-#define SPAWN_COOLDOWN_FRAMES 10
+static void toi_schedule(ToiQueue* q, size_t body, float time) {
+    q->next_time[body] = time;
+    toi_heap_fix(q, q->heap_pos[body]);
+}
 
-typedef struct {
-    int count;          // number of bodies in this group
-    float radius;       // visual + collision radius
-    float rise_speed;   // base upward speed (negative vy, since y grows downward)
-    float restitution;  // bounciness 0..1
-    float pop_chance;   // chance to pop on collision
-    const char* name;   // not stored on disk
-} BubbleGroupConfig;
+static void toi_invalidate(ToiQueue* q) {
+    q->valid = false;
+}
 
-// What gets written to disk (no pointers)
-typedef struct {
-    int count;
-    float radius;
-    float rise_speed;
-    float restitution;
-    float pop_chance;
-} BubbleGroupConfigDisk;
+// Body was moved outside the step (respawn etc.): check its row next frame
+static void toi_touch(ToiQueue* q, size_t body) {
+    if(!q->valid || body >= q->count) return;
+    toi_schedule(q, body, q->now);
+}
 
-typedef struct {
-    BubbleGroupConfigDisk groups[GROUP_COUNT];
-} BubbleConfig;
+// Time until a body can enter the collidable band, bounded by its speed
+static float toi_visible_in(const PhysicsBody* b, const WorldBounds* bounds, float speed) {
+    if(!bounds || body_is_visible_vertical(b, bounds)) return 0.0f;
+    float gap = (b->y - b->radius > bounds->max_y) ? (b->y - b->radius) - bounds->max_y :
+                                                     bounds->min_y - (b->y + b->radius);
+    return gap / speed;
+}
 
-typedef enum {
-    ConfigFieldCount = 0,
-    ConfigFieldRadius,
-    ConfigFieldSpeed,
-    ConfigFieldRestitution,
-    ConfigFieldPopChance,
-    ConfigFieldCountEnum,
-} ConfigField;
+static float toi_body_speed(const PhysicsBody* b) {
+    return sqrtf(ph_len2(b->vx, b->vy)) + fabsf(b->wobble_amplitude) + 0.001f;
+}
 
-typedef struct {
-    Gui* gui;
-    ViewPort* view_port;
-    FuriMessageQueue* queue;
+// Earliest time (from now) the pair could collide, TOI_HORIZON if not soon
+static float toi_pair_bound(
+    const PhysicsBody* a,
+    const PhysicsBody* b,
+    const WorldBounds* bounds,
+    float dt
+) {
+    float gap = sqrtf(ph_len2(b->x - a->x, b->y - a->y)) - (a->radius + b->radius);
+    float speed_a = toi_body_speed(a);
+    float speed_b = toi_body_speed(b);
+    float t = gap > 0.0f ? gap / (speed_a + speed_b) : 0.0f;
 
-    PhysicsBody bodies[MAX_BODIES];
-    size_t body_count;
+    // Not collidable until at least one of them is on screen...
+    float vis = fminf(toi_visible_in(a, bounds, speed_a), toi_visible_in(b, bounds, speed_b));
+    if(vis > t) t = vis;
 
-    WorldBounds bounds;
-    float gravity_y;
+    // ...and both are out of spawn cooldown
+    int cooldown = a->spawn_cooldown > b->spawn_cooldown ? a->spawn_cooldown : b->spawn_cooldown;
+    float cd = (float)cooldown * dt;
+    if(cd > t) t = cd;
 
-    BubbleGroupConfig groups[GROUP_COUNT];
-    int selected_group;   // 0,1,2
-    ConfigField menu_field;
+    return t < TOI_HORIZON ? t : TOI_HORIZON;
+}
 
-    SimpleRng rng;
+static bool toi_body_active(const PhysicsBody* b) {
+    return !b->popped && b->pop_anim_timer <= 0;
+}
 
-    bool hud_visible;     // NEW: toggles HUD (footer text + highlight)
-} BubbleApp;
+// Earliest bound of body i against every other active body
+static float toi_row_bound(
+    const PhysicsBody* bodies,
+    size_t count,
+    size_t i,
+    const WorldBounds* bounds,
+    float dt
+) {
+    float best = TOI_HORIZON;
+    if(!toi_body_active(&bodies[i])) return best; // respawn will touch it
+    for(size_t j = 0; j < count; j++) {
+        if(j == i || !toi_body_active(&bodies[j])) continue;
+        float t = toi_pair_bound(&bodies[i], &bodies[j], bounds, dt);
+        if(t < best) best = t;
+    }
+    return best;
+}
 
-typedef enum {
-    EventTypeInput,
-} BubbleEventType;
+static bool toi_rebuild(
+    ToiQueue* q,
+    const PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds,
+    float dt
+) {
+    if(count > TOI_MAX_BODIES) return false;
 
-typedef struct {
-    BubbleEventType type;
-    InputEvent input;
-} BubbleEvent;
+    q->count = count;
+    q->now = 0.0f;
+    for(size_t i = 0; i < count; i++) {
+        q->heap[i] = (uint8_t)i;
+        q->heap_pos[i] = (uint8_t)i;
+        q->next_time[i] = toi_row_bound(bodies, count, i, bounds, dt);
+    }
+    for(size_t i = count / 2; i-- > 0;) {
+        toi_heap_fix(q, i);
+    }
+    q->valid = true;
+    return true;
+}
 
-// --- Config save/load -------------------------------------------------------
+// Check body i against everyone; contacts wake the partner for this frame
+static bool toi_process_row(
+    ToiQueue* q,
+    PhysicsBody* bodies,
+    size_t count,
+    size_t i,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    PhysicsBody* a = &bodies[i];
+    if(!toi_body_active(a) || a->spawn_cooldown > 0) return false;
 
-static void bubble_save_config(const BubbleApp* app) {
-    Storage* storage = furi_record_open(RECORD_STORAGE);
-    if(!storage) return;
+    bool vis_a = body_is_visible_vertical(a, bounds);
+    bool touched = false;
 
-    // Ensure app data directory exists: /ext/apps_data/<appid>/
-    storage_common_mkdir(storage, APP_DATA_PATH(""));
+    for(size_t j = 0; j < count; j++) {
+        PhysicsBody* b = &bodies[j];
+        if(j == i || !toi_body_active(b) || b->spawn_cooldown > 0) continue;
+        if(!vis_a && !body_is_visible_vertical(b, bounds)) continue;
 
-    File* file = storage_file_alloc(storage);
-    if(!file) {
-        furi_record_close(RECORD_STORAGE);
-        return;
+        if(physics_resolve_pair(a, b, rng, stats)) {
+            touched = true;
+            if(q->next_time[j] > q->now) toi_schedule(q, j, q->now);
+            if(!toi_body_active(a)) break; // popped
+        }
     }
 
-    // storage_file_open returns bool: true on success
-    if(storage_file_open(file, BUBBLE_CFG_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
-        BubbleConfig cfg;
+    return touched;
+}
 
-        for(int i = 0; i < GROUP_COUNT; i++) {
-            cfg.groups[i].count = app->groups[i].count;
-            cfg.groups[i].radius = app->groups[i].radius;
-            cfg.groups[i].rise_speed = app->groups[i].rise_speed;
-            cfg.groups[i].restitution = app->groups[i].restitution;
-            cfg.groups[i].pop_chance = app->groups[i].pop_chance;
+// Same contract as physics_step. Falls back to stepping when the scene is too
+// dense for events to pay off (more than half the bodies due in one frame).
+static void physics_step_events(
+    ToiQueue* q,
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    float gravity_y,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(dt <= 0.0f) return;
+    if(!bodies || count == 0) return;
+    if(!stats) stats = &stats_sink;
+
+    physics_integrate(bodies, count, dt, gravity_y, bounds, stats);
+    q->now += dt;
+    q->last_events = 0;
+    q->last_stepped = true;
+
+    // Bounds assume constant velocity
+    bool accelerating = gravity_y != 0.0f;
+    for(size_t i = 0; i < count && !accelerating; i++) {
+        accelerating = bodies[i].ax != 0.0f || bodies[i].ay != 0.0f;
+    }
+
+    if(accelerating || count != q->count) toi_invalidate(q);
+
+    if(!q->valid) {
+        if(accelerating || q->backoff > 0 || !toi_rebuild(q, bodies, count, bounds, dt)) {
+            if(q->backoff > 0) q->backoff--;
+            physics_collide_naive(bodies, count, bounds, NULL, rng, stats);
+            return;
         }
+    }
 
-        storage_file_write(file, &cfg, sizeof(cfg));
-        storage_file_sync(file);
+    size_t budget = count / 2 + 1;
+    uint64_t done = 0; // rows already resolved against every body this frame
+    while(q->next_time[q->heap[0]] <= q->now) {
+        if(q->last_events >= budget) {
+            // Dense: finish this frame by stepping and stay there for a while.
+            // Only pairs between rows not yet processed, so no pair is
+            // resolved (or rolled for a pop) twice.
+            toi_invalidate(q);
+            q->backoff = TOI_BACKOFF_FRAMES;
+            uint64_t near[TOI_MAX_BODIES];
+            for(size_t k = 0; k < count; k++) {
+                near[k] = done & (1ull << k) ? 0 : ~done;
+            }
+            physics_collide_naive(bodies, count, bounds, near, rng, stats);
+            return;
+        }
+
+        size_t i = q->heap[0];
+        q->last_events++;
+        done |= 1ull << i;
+
+        if(toi_process_row(q, bodies, count, i, bounds, rng, stats)) {
+            // It moved this frame; look again next frame
+            toi_schedule(q, i, q->now + dt);
+        } else {
+            float t = toi_row_bound(bodies, count, i, bounds, dt);
+            toi_schedule(q, i, q->now + (t > dt ? t : dt));
+        }
     }
 
-    storage_file_close(file);
-    storage_file_free(file);
-    furi_record_close(RECORD_STORAGE);
+    q->last_stepped = false;
 }
 
-static void bubble_load_config(BubbleApp* app) {
-    Storage* storage = furi_record_open(RECORD_STORAGE);
-    if(!storage) return;
+// --- Profiling --------------------------------------------------------------
 
-    File* file = storage_file_alloc(storage);
-    if(!file) {
-        furi_record_close(RECORD_STORAGE);
-        return;
+// DWT cycle counter; furi_hal enables it at boot for its microsecond delays
+static inline uint32_t perf_cycles(void) {
+    return DWT->CYCCNT;
+}
+
+typedef struct {
+    uint32_t step_cycles;      // last physics step
+    uint64_t window_cycles;    // physics cycles in the current window
+    float window_sim_time;     // simulated seconds in the current window
+    uint32_t cycles_per_sim_s; // physics cost per simulated second, last window
+    uint32_t draw_cycles;      // last draw callback (GUI thread)
+    uint32_t raster_cycles;    // last render-ahead rasterization (app thread)
+    uint32_t step_pair_tests;  // narrow phase pair tests in the last step
+    uint32_t blast_cycles;     // pop blasts and chains in the last step
+    uint32_t step_blast_queries;
+    uint32_t bus_cycles; // event dispatch after the last step
+} BubblePerf;
+
+static void perf_record_step(BubblePerf* perf, uint32_t cycles, float dt) {
+    perf->step_cycles = cycles;
+    perf->window_cycles += cycles;
+    perf->window_sim_time += dt;
+    if(perf->window_sim_time >= 1.0f) {
+        perf->cycles_per_sim_s = (uint32_t)((float)perf->window_cycles / perf->window_sim_time);
+        perf->window_cycles = 0;
+        perf->window_sim_time = 0.0f;
     }
+}
 
-    if(storage_file_open(file, BUBBLE_CFG_PATH, FSAM_READ, FSOM_OPEN_EXISTING)) {
-        BubbleConfig cfg;
-        size_t rd = storage_file_read(file, &cfg, sizeof(cfg));
-        if(rd == sizeof(cfg)) {
-            // Copy into runtime groups, preserving .name pointers
-            for(int i = 0; i < GROUP_COUNT; i++) {
-                app->groups[i].count = cfg.groups[i].count;
-                app->groups[i].radius = cfg.groups[i].radius;
-                app->groups[i].rise_speed = cfg.groups[i].rise_speed;
-                app->groups[i].restitution = cfg.groups[i].restitution;
-                app->groups[i].pop_chance = cfg.groups[i].pop_chance;
-            }
+// --- Broadphase -------------------------------------------------------------
+//
+// Candidate pairs for the step, so the narrow phase only sees bodies whose
+// bounding boxes share a cell. Cells tile the world bounds and anything
+// outside is clamped into the border cells, which keeps overlapping boxes
+// overlapping. Two structures over the same cell rectangles:
+//  - uniform grid: per-cell body lists; a pair is only reported by the cell
+//    at the top-left corner of the two rectangles' intersection, so once.
+//  - bitboards: 4 px cells, one uint32 per row (32 columns = 128 px) and one
+//    board per group, i.e. the screen's 1-bit format at low resolution. A
+//    body ANDs its column mask with a group's row words to skip groups it
+//    can't touch, then with each member's mask.
+// Bodies in spawn cooldown never collide and stay out. So do off-screen
+// bodies too far from the band to reach anything on it.
+
+#define BP_MAX_BODIES 64
+#define BP_MAX_PAIRS 512
+#define BP_GRID_MAX_CELLS 512
+#define BP_GRID_MAX_ENTRIES 1024
+#define BB_CELL_SHIFT 2 // 4 px
+#define BB_COLS 32      // bits in a row word
+#define BB_ROWS 16
+
+typedef enum {
+    BroadphaseNaive = 0, // every pair, no structure
+    BroadphaseGrid,
+    BroadphaseBitboard,
+} BroadphaseKind;
+
+typedef struct {
+    uint8_t a;
+    uint8_t b;
+} BodyPair;
+
+typedef struct {
+    BroadphaseKind kind;
+    uint8_t cell_shift; // grid cell size is 1 << cell_shift px
+
+    // Per body, this step: cell rectangle (inclusive) and membership masks
+    uint8_t cx0[BP_MAX_BODIES];
+    uint8_t cx1[BP_MAX_BODIES];
+    uint8_t cy0[BP_MAX_BODIES];
+    uint8_t cy1[BP_MAX_BODIES];
+    uint64_t live;    // in the structure
+    uint64_t visible; // touches the collidable band
+
+    // Uniform grid: singly linked entry list per cell
+    uint8_t cols;
+    uint8_t rows;
+    int16_t cell_head[BP_GRID_MAX_CELLS];
+    int16_t entry_next[BP_GRID_MAX_ENTRIES];
+    uint8_t entry_body[BP_GRID_MAX_ENTRIES];
+    size_t entry_count;
+
+    // Bitboards
+    uint32_t group_rows[PHYSICS_MAX_GROUPS][BB_ROWS];
+    uint32_t col_mask[BP_MAX_BODIES];
+    uint8_t members[PHYSICS_MAX_GROUPS][BP_MAX_BODIES];
+    uint8_t member_count[PHYSICS_MAX_GROUPS];
+
+    BodyPair pairs[BP_MAX_PAIRS];
+    size_t pair_count;
+
+    // Query index: the grid above filled again over current positions with
+    // every active body, see broadphase_index()
+    bool query_ready; // matches the positions; cleared by builds and steps
+    bool indexed;     // in the grid, else queries scan
+    uint8_t query_shift;
+    float origin_x;
+    float origin_y;
+    const PhysicsBody* query_bodies;
+    size_t query_count;
+    uint32_t index_cycles;
+
+    // Last step, for the HUD
+    uint32_t build_cycles; // pair generation included
+    bool fell_back;        // didn't fit, the naive loop ran instead
+
+    // Optional, set by the caller for one step: per body, the bodies whose
+    // proxy overlaps its own (see the sticky clusters); NULL pairs everyone
+    const uint64_t* near;
+} Broadphase;
+
+static inline int bp_cell(float v, float origin, uint8_t shift, int cells) {
+    int c = (int)floorf(v - origin);
+    c = c < 0 ? 0 : c >> shift;
+    return c < cells ? c : cells - 1;
+}
+
+// Cell rectangles and masks for every body that can collide this step
+static void bp_prepare(
+    Broadphase* bp,
+    const PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds,
+    uint8_t shift,
+    int cols,
+    int rows,
+    bool for_pairs
+) {
+    bp->live = 0;
+    bp->visible = 0;
+
+    float reach = 0.0f;
+    for(size_t i = 0; i < count; i++) {
+        if(bodies[i].radius > reach) reach = bodies[i].radius;
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        const PhysicsBody* b = &bodies[i];
+        if(b->popped || b->pop_anim_timer > 0) continue;
+        if(for_pairs && b->spawn_cooldown > 0) continue;
+
+        float top = b->y - b->radius;
+        float bottom = b->y + b->radius;
+        if(body_is_visible_vertical(b, bounds)) {
+            bp->visible |= 1ull << i;
+        } else if(
+            for_pairs &&
+            (top - bounds->max_y > 2.0f * reach || bounds->min_y - bottom > 2.0f * reach)) {
+            continue; // can't reach anything that is on the band
         }
+
+        bp->live |= 1ull << i;
+        bp->cx0[i] = (uint8_t)bp_cell(b->x - b->radius, bounds->min_x, shift, cols);
+        bp->cx1[i] = (uint8_t)bp_cell(b->x + b->radius, bounds->min_x, shift, cols);
+        bp->cy0[i] = (uint8_t)bp_cell(top, bounds->min_y, shift, rows);
+        bp->cy1[i] = (uint8_t)bp_cell(bottom, bounds->min_y, shift, rows);
     }
+}
 
-    storage_file_close(file);
-    storage_file_free(file);
-    furi_record_close(RECORD_STORAGE);
+static bool bp_emit(Broadphase* bp, size_t i, size_t j) {
+    uint64_t both = (1ull << i) | (1ull << j);
+    if(!(bp->visible & both)) return true; // both off screen
+    if(bp->pair_count >= BP_MAX_PAIRS) return false;
+    bp->pairs[bp->pair_count].a = (uint8_t)(i < j ? i : j);
+    bp->pairs[bp->pair_count].b = (uint8_t)(i < j ? j : i);
+    bp->pair_count++;
+    return true;
 }
 
-// --- Bubble sim helpers -----------------------------------------------------
+// Per-cell lists of every live body, false if the entry table overflows
+static bool bp_fill_grid(Broadphase* bp, size_t count) {
+    size_t cells = (size_t)bp->cols * bp->rows;
+    for(size_t c = 0; c < cells; c++) {
+        bp->cell_head[c] = -1;
+    }
+    bp->entry_count = 0;
 
-static void bubble_app_init_groups(BubbleApp* app) {
-    app->groups[0].name = "Small";
-    app->groups[0].count = 22;
-    app->groups[0].radius = 3.0f;
-    app->groups[0].rise_speed = 60.0f;
-    app->groups[0].restitution = 0.8f;
-    app->groups[0].pop_chance = 1.0f; // default: no popping?
-
-    app->groups[1].name = "Medium";
-    app->groups[1].count = 10;
-    app->groups[1].radius = 8.0f;
-    app->groups[1].rise_speed = 11.0f;
-    app->groups[1].restitution = 0.15f;
-    app->groups[1].pop_chance = 0.10f;
-
-    app->groups[2].name = "Large";
-    app->groups[2].count = 4;
-    app->groups[2].radius = 16.0f;
-    app->groups[2].rise_speed = 4.0f;
-    app->groups[2].restitution = 0.05f;
-    app->groups[2].pop_chance = 0.10f;
+    for(size_t i = 0; i < count; i++) {
+        if(!(bp->live & (1ull << i))) continue;
+        for(int cy = bp->cy0[i]; cy <= bp->cy1[i]; cy++) {
+            for(int cx = bp->cx0[i]; cx <= bp->cx1[i]; cx++) {
+                if(bp->entry_count >= BP_GRID_MAX_ENTRIES) return false;
+                size_t c = (size_t)cy * bp->cols + (size_t)cx;
+                bp->entry_body[bp->entry_count] = (uint8_t)i;
+                bp->entry_next[bp->entry_count] = bp->cell_head[c];
+                bp->cell_head[c] = (int16_t)bp->entry_count++;
+            }
+        }
+    }
+    return true;
 }
 
-// Helper: initialize wobble parameters for a bubble
-static void bubble_init_wobble(BubbleApp* app, PhysicsBody* b) {
-    // Slightly stronger wobble for larger groups
-    float base_amp = 1.0f + (float)b->group; // 1,2,3 by group
-    b->wobble_phase = rng_next_float01(&app->rng) * 6.2831853f;
-    b->wobble_speed = 0.5f + rng_next_float01(&app->rng) * 0.7f; // 0.5–1.2 rad/s
-    b->wobble_amplitude = base_amp;
+static bool bp_build_grid(Broadphase* bp, size_t count) {
+    if(!bp_fill_grid(bp, count)) return false;
+
+    size_t cells = (size_t)bp->cols * bp->rows;
+    for(size_t c = 0; c < cells; c++) {
+        int cx = (int)(c % bp->cols);
+        int cy = (int)(c / bp->cols);
+        for(int e = bp->cell_head[c]; e >= 0; e = bp->entry_next[e]) {
+            size_t i = bp->entry_body[e];
+            for(int f = bp->entry_next[e]; f >= 0; f = bp->entry_next[f]) {
+                size_t j = bp->entry_body[f];
+                // Only the first cell the two share reports them
+                int x0 = bp->cx0[i] > bp->cx0[j] ? bp->cx0[i] : bp->cx0[j];
+                int y0 = bp->cy0[i] > bp->cy0[j] ? bp->cy0[i] : bp->cy0[j];
+                if(x0 != cx || y0 != cy) continue;
+                if(!bp_emit(bp, i, j)) return false;
+            }
+        }
+    }
+    return true;
 }
 
-// Rebuild all bodies based on group configs
-static void bubble_app_build_bodies(BubbleApp* app) {
-    app->body_count = 0;
+static bool bp_build_bitboard(Broadphase* bp, const PhysicsBody* bodies, size_t count) {
+    memset(bp->group_rows, 0, sizeof(bp->group_rows));
+    memset(bp->member_count, 0, sizeof(bp->member_count));
 
-    for(int g = 0; g < GROUP_COUNT; g++) {
-        BubbleGroupConfig* cfg = &app->groups[g];
-        int count = cfg->count;
-        if(count < 0) count = 0;
+    for(size_t i = 0; i < count; i++) {
+        if(!(bp->live & (1ull << i))) continue;
+        int g = bodies[i].group;
+        uint32_t mask = (uint32_t)((2ull << bp->cx1[i]) - (1ull << bp->cx0[i]));
+        bp->col_mask[i] = mask;
+        for(int r = bp->cy0[i]; r <= bp->cy1[i]; r++) {
+            bp->group_rows[g][r] |= mask;
+        }
+        bp->members[g][bp->member_count[g]++] = (uint8_t)i;
+    }
 
-        for(int i = 0; i < count && app->body_count < MAX_BODIES; i++) {
-            PhysicsBody* b = &app->bodies[app->body_count++];
+    for(size_t i = 0; i < count; i++) {
+        if(!(bp->live & (1ull << i))) continue;
+        uint32_t mask = bp->col_mask[i];
 
-            b->radius = cfg->radius;
-            b->inv_mass = 1.0f; // all dynamic
-            b->restitution = cfg->restitution;
-            b->group = g;
-            b->pop_chance = cfg->pop_chance;
-            b->popped = false;
-            b->pop_anim_timer = 0;
+        for(int g = 0; g < PHYSICS_MAX_GROUPS; g++) {
+            uint32_t hit = 0;
+            for(int r = bp->cy0[i]; r <= bp->cy1[i] && !hit; r++) {
+                hit = bp->group_rows[g][r] & mask;
+            }
+            if(!hit) continue; // nothing of this group near i
 
-            float r = b->radius;
+            for(size_t m = 0; m < bp->member_count[g]; m++) {
+                size_t j = bp->members[g][m];
+                if(j <= i || !(bp->col_mask[j] & mask)) continue;
+                if(bp->cy0[j] > bp->cy1[i] || bp->cy0[i] > bp->cy1[j]) continue;
+                if(!bp_emit(bp, i, j)) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Fill bp->pairs for this step. False when the structure doesn't fit (too
+// many bodies, cells or pairs); the caller then runs the naive loop.
+static bool broadphase_build(
+    Broadphase* bp,
+    const PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds
+) {
+    uint32_t start = perf_cycles();
+    bp->pair_count = 0;
+    bp->fell_back = false;
+    bp->query_ready = false; // the grid storage is about to be reused
+    bp->indexed = false;
+    if(bp->kind == BroadphaseNaive) return false;
+
+    bool ok = false;
+    if(bounds && count <= BP_MAX_BODIES) {
+        int width = (int)(bounds->max_x - bounds->min_x) + 1;
+        int height = (int)(bounds->max_y - bounds->min_y) + 1;
+        uint8_t shift = bp->kind == BroadphaseBitboard ? BB_CELL_SHIFT : bp->cell_shift;
+        int cols = (width + (1 << shift) - 1) >> shift;
+        int rows = (height + (1 << shift) - 1) >> shift;
+
+        if(bp->kind == BroadphaseBitboard) {
+            if(cols > BB_COLS) cols = BB_COLS;
+            if(rows > BB_ROWS) rows = BB_ROWS;
+            bp_prepare(bp, bodies, count, bounds, shift, cols, rows, true);
+            ok = bp_build_bitboard(bp, bodies, count);
+        } else if(cols * rows <= BP_GRID_MAX_CELLS) {
+            bp->cols = (uint8_t)cols;
+            bp->rows = (uint8_t)rows;
+            bp_prepare(bp, bodies, count, bounds, shift, cols, rows, true);
+            ok = bp_build_grid(bp, count);
+        }
+    }
+
+    bp->fell_back = !ok;
+    bp->build_cycles = perf_cycles() - start;
+    return ok;
+}
+
+// Narrow phase over the candidate list, same checks as the naive loop
+static void physics_collide_pairs(
+    const Broadphase* bp,
+    PhysicsBody* bodies,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    for(size_t p = 0; p < bp->pair_count; p++) {
+        const BodyPair* pair = &bp->pairs[p];
+        if(bp->near && !(bp->near[pair->a] & (1ull << pair->b))) continue; // proxies apart
+        PhysicsBody* a = &bodies[pair->a];
+        PhysicsBody* b = &bodies[pair->b];
+        if(a->popped || b->popped) continue; // popped earlier this step
+        physics_resolve_pair(a, b, rng, stats);
+    }
+}
+
+// Same contract as physics_step, pairs from the broadphase when it fits
+static void physics_step_broadphase(
+    Broadphase* bp,
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    float gravity_y,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(dt <= 0.0f) return;
+    if(!bodies || count == 0) return;
+    if(!stats) stats = &stats_sink;
+
+    physics_integrate(bodies, count, dt, gravity_y, bounds, stats);
 
-            // random horizontal position
-            float x = (float)(app->bounds.min_x + r) +
-                      rng_next_float01(&app->rng) *
-                          (float)((app->bounds.max_x - r) - (app->bounds.min_x + r));
+    if(broadphase_build(bp, bodies, count, bounds)) {
+        physics_collide_pairs(bp, bodies, rng, stats);
+    } else {
+        physics_collide_naive(bodies, count, bounds, bp->near, rng, stats);
+    }
+}
 
-            // spawn well below the bottom to avoid visible jitter
-            float y_base = app->bounds.max_y + r + 40.0f;
-            float y = y_base + rng_next_float01(&app->rng) * 20.0f;
+// --- Spatial queries --------------------------------------------------------
+//
+// Which bodies are in a rect or a circle, nearest a point, or first along a
+// ray. Queries run on an index of every active body (cooldown and offscreen
+// ones too) at its current position: the broadphase grid storage filled
+// once more, at the Grid broadphase's cell size when that is selected and
+// 16 px otherwise. Results go to caller buffers as body indices. An index
+// that doesn't fit the grid tables answers by scanning instead, and the
+// next broadphase build reuses the storage, so index again after each step.
 
-            b->x = x;
-            b->y = y;
+#define BP_QUERY_SHIFT 4
+
+typedef struct {
+    uint8_t body;
+    float dist; // nearest: to the centre; raycast: to the rim
+} QueryHit;
 
-            // Upward velocity (negative in screen coords)
-            float jitter = (rng_next_float01(&app->rng) - 0.5f) * cfg->rise_speed * 0.2f;
-            b->vx = jitter;
-            b->vy = -cfg->rise_speed;
+static void broadphase_index(
+    Broadphase* bp,
+    const PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds
+) {
+    furi_check(count <= BP_MAX_BODIES);
+    uint32_t start = perf_cycles();
+    bp->query_bodies = bodies;
+    bp->query_count = count;
+    bp->query_ready = true;
+    bp->indexed = false;
+
+    uint8_t shift = bp->kind == BroadphaseGrid ? bp->cell_shift : BP_QUERY_SHIFT;
+    int cols = ((int)(bounds->max_x - bounds->min_x) + (1 << shift)) >> shift;
+    int rows = ((int)(bounds->max_y - bounds->min_y) + (1 << shift)) >> shift;
+    if(cols * rows <= BP_GRID_MAX_CELLS) {
+        bp->cols = (uint8_t)cols;
+        bp->rows = (uint8_t)rows;
+        bp->query_shift = shift;
+        bp->origin_x = bounds->min_x;
+        bp->origin_y = bounds->min_y;
+        bp_prepare(bp, bodies, count, bounds, shift, cols, rows, false);
+        bp->indexed = bp_fill_grid(bp, count);
+    }
+    bp->index_cycles = perf_cycles() - start;
+}
 
-            b->ax = 0.0f;
-            b->ay = 0.0f;
-            b->spawn_cooldown = SPAWN_COOLDOWN_FRAMES;
+// Unique active bodies listed in the cells under the rect, or all of them
+// without a grid. cand holds BP_MAX_BODIES.
+static size_t bp_query_candidates(
+    const Broadphase* bp,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    uint8_t* cand
+) {
+    size_t n = 0;
+    if(!bp->indexed) {
+        for(size_t i = 0; i < bp->query_count; i++) {
+            const PhysicsBody* b = &bp->query_bodies[i];
+            if(!b->popped && b->pop_anim_timer <= 0) cand[n++] = (uint8_t)i;
+        }
+        return n;
+    }
 
-            bubble_init_wobble(app, b);
+    int cx0 = bp_cell(x0, bp->origin_x, bp->query_shift, bp->cols);
+    int cx1 = bp_cell(x1, bp->origin_x, bp->query_shift, bp->cols);
+    int cy0 = bp_cell(y0, bp->origin_y, bp->query_shift, bp->rows);
+    int cy1 = bp_cell(y1, bp->origin_y, bp->query_shift, bp->rows);
+    uint64_t seen = 0; // bodies span cells; report each once
+
+    for(int cy = cy0; cy <= cy1; cy++) {
+        for(int cx = cx0; cx <= cx1; cx++) {
+            for(int e = bp->cell_head[cy * bp->cols + cx]; e >= 0; e = bp->entry_next[e]) {
+                size_t i = bp->entry_body[e];
+                if(seen & (1ull << i)) continue;
+                seen |= 1ull << i;
+                cand[n++] = (uint8_t)i;
+            }
         }
     }
+    return n;
 }
 
-// Reinitialize only a single group's bodies
-static void bubble_app_reinit_group(BubbleApp* app, int group_id) {
-    if(group_id < 0 || group_id >= GROUP_COUNT) return;
+// Bodies overlapping the rect, at most cap of them. Returns how many.
+static size_t broadphase_query_rect(
+    const Broadphase* bp,
+    float x0,
+    float y0,
+    float x1,
+    float y1,
+    uint8_t* out,
+    size_t cap
+) {
+    uint8_t cand[BP_MAX_BODIES];
+    size_t count = bp_query_candidates(bp, x0, y0, x1, y1, cand);
+    size_t n = 0;
+    for(size_t k = 0; k < count && n < cap; k++) {
+        const PhysicsBody* b = &bp->query_bodies[cand[k]];
+        float nx = b->x < x0 ? x0 : (b->x > x1 ? x1 : b->x);
+        float ny = b->y < y0 ? y0 : (b->y > y1 ? y1 : b->y);
+        if(ph_len2(b->x - nx, b->y - ny) <= b->radius * b->radius) out[n++] = cand[k];
+    }
+    return n;
+}
 
-    BubbleGroupConfig* cfg = &app->groups[group_id];
+// Bodies overlapping the circle, at most cap of them. Returns how many.
+static size_t broadphase_query_circle(
+    const Broadphase* bp,
+    float x,
+    float y,
+    float r,
+    uint8_t* out,
+    size_t cap
+) {
+    uint8_t cand[BP_MAX_BODIES];
+    size_t count = bp_query_candidates(bp, x - r, y - r, x + r, y + r, cand);
+    size_t n = 0;
+    for(size_t k = 0; k < count && n < cap; k++) {
+        const PhysicsBody* b = &bp->query_bodies[cand[k]];
+        float reach = r + b->radius;
+        if(ph_len2(b->x - x, b->y - y) <= reach * reach) out[n++] = cand[k];
+    }
+    return n;
+}
 
-    // First, remove existing bodies of this group
-    size_t write = 0;
-    for(size_t i = 0; i < app->body_count; i++) {
-        if(app->bodies[i].group == group_id) continue;
-        if(write != i) app->bodies[write] = app->bodies[i];
-        write++;
+// Keep the k closest hits sorted, nearest first
+static void bp_hit_insert(QueryHit* hits, size_t* n, size_t k, size_t body, float dist) {
+    size_t i = *n;
+    if(i == k) {
+        if(dist >= hits[k - 1].dist) return;
+        i = k - 1;
+    } else {
+        (*n)++;
     }
-    app->body_count = write;
+    for(; i > 0 && hits[i - 1].dist > dist; i--) {
+        hits[i] = hits[i - 1];
+    }
+    hits[i].body = (uint8_t)body;
+    hits[i].dist = dist;
+}
 
-    // Add new ones based on updated config
-    int count = cfg->count;
-    if(count < 0) count = 0;
+// The k bodies with centres nearest to (x, y), nearest first. Returns how
+// many were found (fewer than k only if there aren't k active bodies).
+static size_t broadphase_query_nearest(
+    const Broadphase* bp,
+    float x,
+    float y,
+    size_t k,
+    QueryHit* out
+) {
+    size_t n = 0;
+    if(!k) return 0;
+
+    if(!bp->indexed) {
+        for(size_t i = 0; i < bp->query_count; i++) {
+            const PhysicsBody* b = &bp->query_bodies[i];
+            if(b->popped || b->pop_anim_timer > 0) continue;
+            bp_hit_insert(out, &n, k, i, sqrtf(ph_len2(b->x - x, b->y - y)));
+        }
+        return n;
+    }
 
-    for(int i = 0; i < count && app->body_count < MAX_BODIES; i++) {
-        PhysicsBody* b = &app->bodies[app->body_count++];
+    // Square rings of cells around the query's cell. Every body is listed in
+    // its centre's cell, so after ring d the ones still unseen are centred
+    // at least d cells away and the search can stop once the k-th is closer.
+    int px = bp_cell(x, bp->origin_x, bp->query_shift, bp->cols);
+    int py = bp_cell(y, bp->origin_y, bp->query_shift, bp->rows);
+    int rings = bp->cols > bp->rows ? bp->cols : bp->rows;
+    float cell = (float)(1 << bp->query_shift);
+    uint64_t seen = 0;
+
+    for(int d = 0; d < rings; d++) {
+        for(int cy = py - d; cy <= py + d; cy++) {
+            if(cy < 0 || cy >= bp->rows) continue;
+            int step = (cy == py - d || cy == py + d) ? 1 : 2 * d; // sides only
+            for(int cx = px - d; cx <= px + d; cx += step) {
+                if(cx < 0 || cx >= bp->cols) continue;
+                for(int e = bp->cell_head[cy * bp->cols + cx]; e >= 0; e = bp->entry_next[e]) {
+                    size_t i = bp->entry_body[e];
+                    if(seen & (1ull << i)) continue;
+                    seen |= 1ull << i;
+                    const PhysicsBody* b = &bp->query_bodies[i];
+                    bp_hit_insert(out, &n, k, i, sqrtf(ph_len2(b->x - x, b->y - y)));
+                }
+            }
+        }
+        if(n == k && out[k - 1].dist <= (float)d * cell) break;
+    }
+    return n;
+}
 
-        b->radius = cfg->radius;
-        b->inv_mass = 1.0f;
-        b->restitution = cfg->restitution;
-        b->group = group_id;
-        b->pop_chance = cfg->pop_chance;
-        b->popped = false;
-        b->pop_anim_timer = 0;
+// Ray (unit direction) against one body; true if it hits closer than hit
+static bool bp_ray_test(
+    const PhysicsBody* b,
+    size_t body,
+    float x,
+    float y,
+    float dx,
+    float dy,
+    QueryHit* hit
+) {
+    float ox = b->x - x;
+    float oy = b->y - y;
+    float along = ox * dx + oy * dy;
+    float r2 = b->radius * b->radius;
+    float off2 = ph_len2(ox, oy) - along * along; // centre to the line, squared
+    if(off2 > r2) return false;
+
+    float t = along - sqrtf(r2 - off2);
+    if(t < 0.0f) {
+        if(ph_len2(ox, oy) > r2) return false; // behind the start
+        t = 0.0f;                              // starts inside
+    }
+    if(t > hit->dist) return false;
+    hit->body = (uint8_t)body;
+    hit->dist = t;
+    return true;
+}
 
-        float r = b->radius;
+// First body the ray from (x, y) along (dx, dy) touches within max_dist
+static bool broadphase_raycast(
+    const Broadphase* bp,
+    float x,
+    float y,
+    float dx,
+    float dy,
+    float max_dist,
+    QueryHit* hit
+) {
+    float len = sqrtf(ph_len2(dx, dy));
+    if(len <= 0.0f) return false;
+    dx /= len;
+    dy /= len;
+    hit->dist = max_dist;
+    bool found = false;
+
+    if(!bp->indexed) {
+        for(size_t i = 0; i < bp->query_count; i++) {
+            const PhysicsBody* b = &bp->query_bodies[i];
+            if(b->popped || b->pop_anim_timer > 0) continue;
+            found |= bp_ray_test(b, i, x, y, dx, dy, hit);
+        }
+        return found;
+    }
 
-        float x = (float)(app->bounds.min_x + r) +
-                  rng_next_float01(&app->rng) *
-                      (float)((app->bounds.max_x - r) - (app->bounds.min_x + r));
+    // Walk the cells the ray crosses, nearest first, until the next cell
+    // starts beyond the best hit. Off the grid the walk goes on through
+    // virtual cells clamped onto the border, where outside bodies are
+    // listed, so a ray leaving the screen still finds them.
+    float cell = (float)(1 << bp->query_shift);
+    float fx = (x - bp->origin_x) / cell;
+    float fy = (y - bp->origin_y) / cell;
+    int vx = (int)floorf(fx);
+    int vy = (int)floorf(fy);
+    int sx = dx > 0.0f ? 1 : -1;
+    int sy = dy > 0.0f ? 1 : -1;
+    float step_x = dx != 0.0f ? cell / fabsf(dx) : INFINITY; // ray length per cell
+    float step_y = dy != 0.0f ? cell / fabsf(dy) : INFINITY;
+    float next_x = dx != 0.0f ? (dx > 0.0f ? (float)(vx + 1) - fx : fx - (float)vx) * step_x : INFINITY;
+    float next_y = dy != 0.0f ? (dy > 0.0f ? (float)(vy + 1) - fy : fy - (float)vy) * step_y : INFINITY;
+    uint64_t seen = 0;
+    int last = -1;
+
+    for(float t = 0.0f; t <= hit->dist;) {
+        int cx = vx < 0 ? 0 : (vx >= bp->cols ? bp->cols - 1 : vx);
+        int cy = vy < 0 ? 0 : (vy >= bp->rows ? bp->rows - 1 : vy);
+        int c = cy * bp->cols + cx;
+        if(c != last) {
+            last = c;
+            for(int e = bp->cell_head[c]; e >= 0; e = bp->entry_next[e]) {
+                size_t i = bp->entry_body[e];
+                if(seen & (1ull << i)) continue;
+                seen |= 1ull << i;
+                found |= bp_ray_test(&bp->query_bodies[i], i, x, y, dx, dy, hit);
+            }
+        }
+        if(next_x < next_y) {
+            t = next_x;
+            next_x += step_x;
+            vx += sx;
+        } else {
+            t = next_y;
+            next_y += step_y;
+            vy += sy;
+        }
+    }
+    return found;
+}
 
-        float y_base = app->bounds.max_y + r + 40.0f;
-        float y = y_base + rng_next_float01(&app->rng) * 20.0f;
+// --- Pop chain reactions ----------------------------------------------------
+//
+// A pop pushes its neighbours away with a radial impulse that falls off to
+// zero at the blast radius (measured rim to rim), and every body it reaches
+// may pop in turn. New pops are the ones whose animation timer is still
+// full after the step; neighbours come from a circle query on the
+// broadphase index, and chains run breadth-first. A body pops at most once,
+// so a step costs at most one query per body however big the storm.
 
-        b->x = x;
-        b->y = y;
+#define BLAST_SPEED 30.0f // px/s given to a body touching the popped one
+#define BLAST_RADIUS_STEP 4.0f
+#define BLAST_MAX_RADIUS 32.0f
 
-        float jitter = (rng_next_float01(&app->rng) - 0.5f) * cfg->rise_speed * 0.2f;
-        b->vx = jitter;
-        b->vy = -cfg->rise_speed;
+typedef struct {
+    float radius;       // px, 0 = off
+    float chain_chance; // chance a body the blast reaches pops too
+} BlastConfig;
 
-        b->ax = 0.0f;
-        b->ay = 0.0f;
-        b->spawn_cooldown = SPAWN_COOLDOWN_FRAMES;
+// Returns the number of bodies pushed
+static uint32_t physics_pop_blasts(
+    Broadphase* bp,
+    PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds,
+    const BlastConfig* blast,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(blast->radius <= 0.0f || count > BP_MAX_BODIES) return 0;
 
-        bubble_init_wobble(app, b);
+    uint8_t queue[BP_MAX_BODIES];
+    size_t head = 0;
+    size_t tail = 0;
+    for(size_t i = 0; i < count; i++) {
+        const PhysicsBody* b = &bodies[i];
+        if(b->popped && b->pop_anim_timer == POP_ANIM_FRAMES) queue[tail++] = (uint8_t)i;
+    }
+    if(!tail) return 0;
+
+    uint32_t start = perf_cycles();
+    broadphase_index(bp, bodies, count, bounds);
+
+    uint8_t hits[BP_MAX_BODIES];
+    uint32_t pushed = 0;
+    while(head < tail) {
+        const PhysicsBody* v = &bodies[queue[head++]];
+        size_t n = broadphase_query_circle(bp, v->x, v->y, v->radius + blast->radius, hits, count);
+        stats->blast_queries++;
+
+        for(size_t k = 0; k < n; k++) {
+            PhysicsBody* b = &bodies[hits[k]];
+            if(b == v || b->popped || b->inv_mass <= 0.0f) continue;
+
+            float dx = b->x - v->x;
+            float dy = b->y - v->y;
+            float dist = sqrtf(ph_len2(dx, dy));
+            float gap = dist - v->radius - b->radius;
+            float falloff = gap > 0.0f ? 1.0f - gap / blast->radius : 1.0f;
+            if(dist < 0.001f) {
+                dx = 0.0f; // straight up, the way bubbles go anyway
+                dy = -1.0f;
+                dist = 1.0f;
+            }
+            float dv = BLAST_SPEED * falloff * b->inv_mass / dist;
+            b->vx += dx * dv;
+            b->vy += dy * dv;
+            pushed++;
+
+            if(blast->chain_chance > 0.0f && rng_next_float01(rng) < blast->chain_chance) {
+                b->popped = true;
+                b->pop_anim_timer = POP_ANIM_FRAMES;
+                stats->pops[b->group]++;
+                stats->chain_pops++;
+                sim_emit(SimEventPop, b, v);
+                queue[tail++] = (uint8_t)(b - bodies);
+            }
+        }
     }
+    stats->blast_cycles += perf_cycles() - start;
+    return pushed;
 }
 
-// Respawn a single bubble well below the screen
-static void bubble_respawn_body(BubbleApp* app, PhysicsBody* b) {
-    BubbleGroupConfig* cfg = &app->groups[b->group];
+// --- Multiple worlds ---------------------------------------------------------
 
-    float r = b->radius;
+// An independent world stored as a contiguous slice of a shared body array.
+// Worlds never interact; each has its own walls and pop RNG.
+typedef struct {
+    size_t first;
+    size_t count;
+    WorldBounds bounds;
+    SimpleRng rng;
+    uint32_t step_cycles; // last step of this world alone
+} PhysicsWorld;
+
+// Step several worlds in one call. They share the body array, the stats sink
+// and the broadphase scratch, so a second world costs its own bodies and
+// pairs and nothing more. Pop blasts stay inside the world that popped.
+static void physics_step_worlds(
+    Broadphase* bp,
+    PhysicsBody* bodies,
+    PhysicsWorld* worlds,
+    size_t world_count,
+    float dt,
+    float gravity_y,
+    const BlastConfig* blast,
+    PhysicsStats* stats
+) {
+    for(size_t w = 0; w < world_count; w++) {
+        PhysicsWorld* world = &worlds[w];
+        uint32_t start = perf_cycles();
+        physics_step_broadphase(
+            bp,
+            bodies + world->first,
+            world->count,
+            dt,
+            gravity_y,
+            &world->bounds,
+            &world->rng,
+            stats);
+        physics_pop_blasts(
+            bp, bodies + world->first, world->count, &world->bounds, blast, &world->rng, stats);
+        world->step_cycles = perf_cycles() - start;
+    }
+}
 
-    float x = (float)(app->bounds.min_x + r) +
-              rng_next_float01(&app->rng) *
-                  (float)((app->bounds.max_x - r) - (app->bounds.min_x + r));
+// --- Packed int16 kernels ---------------------------------------------------
+//
+// Optional fixed-point path: x and y share one 32-bit word as two Q7 int16
+// lanes (x low, y high, 1/128 px, +-256 px range), so the Cortex-M4 DSP
+// extension moves and measures both axes in a single instruction. Every
+// intrinsic also has a portable emulation with identical wrapping semantics;
+// the kernels are stamped out once per flavour and pk_selftest() checks they
+// agree bit for bit.
 
-    float y_base = app->bounds.max_y + r + 40.0f;
-    float y = y_base + rng_next_float01(&app->rng) * 20.0f;
+#define PK_SHIFT 7
+#define PK_ONE (1 << PK_SHIFT)
+#define PK_MAX_BODIES 64
+#define PK_ROUND_SLOP 3 // Q7 units: covers rounding both bodies to the lattice
 
-    b->x = x;
-    b->y = y;
+typedef uint32_t Packed16;
 
-    float jitter = (rng_next_float01(&app->rng) - 0.5f) * cfg->rise_speed * 0.2f;
-    b->vx = jitter;
-    b->vy = -cfg->rise_speed;
+static inline Packed16 pk_pack(int16_t lo, int16_t hi) {
+    return (uint32_t)(uint16_t)lo | ((uint32_t)(uint16_t)hi << 16);
+}
 
-    b->ax = 0.0f;
-    b->ay = 0.0f;
-    b->spawn_cooldown = SPAWN_COOLDOWN_FRAMES;
-    b->popped = false;
-    b->pop_anim_timer = 0;
+static inline int16_t pk_lo(Packed16 v) {
+    return (int16_t)(uint16_t)(v & 0xFFFFu);
+}
+
+static inline int16_t pk_hi(Packed16 v) {
+    return (int16_t)(uint16_t)(v >> 16);
+}
+
+static inline int16_t pk_from_float(float v) {
+    float f = v * (float)PK_ONE;
+    f += (f >= 0.0f) ? 0.5f : -0.5f;
+    if(f > 32767.0f) f = 32767.0f;
+    if(f < -32768.0f) f = -32768.0f;
+    return (int16_t)f;
+}
+
+static inline float pk_to_float(int16_t v) {
+    return (float)v * (1.0f / (float)PK_ONE);
+}
+
+// SADD16: lane-wise add, wrapping
+static inline Packed16 pk_emu_sadd16(Packed16 a, Packed16 b) {
+    uint16_t lo = (uint16_t)((a & 0xFFFFu) + (b & 0xFFFFu));
+    uint16_t hi = (uint16_t)((a >> 16) + (b >> 16));
+    return (uint32_t)lo | ((uint32_t)hi << 16);
+}
+
+// SSUB16: lane-wise subtract, wrapping
+static inline Packed16 pk_emu_ssub16(Packed16 a, Packed16 b) {
+    uint16_t lo = (uint16_t)((a & 0xFFFFu) - (b & 0xFFFFu));
+    uint16_t hi = (uint16_t)((a >> 16) - (b >> 16));
+    return (uint32_t)lo | ((uint32_t)hi << 16);
+}
+
+// SMUAD: lo*lo + hi*hi, wrapping to 32 bits (the core sets Q on overflow)
+static inline int32_t pk_emu_smuad(Packed16 a, Packed16 b) {
+    int64_t sum = (int64_t)pk_lo(a) * pk_lo(b) + (int64_t)pk_hi(a) * pk_hi(b);
+    return (int32_t)(uint32_t)sum;
+}
+
+// SHADD16: lane-wise (a + b) >> 1, never overflows
+static inline Packed16 pk_emu_shadd16(Packed16 a, Packed16 b) {
+    int16_t lo = (int16_t)(((int32_t)pk_lo(a) + pk_lo(b)) >> 1);
+    int16_t hi = (int16_t)(((int32_t)pk_hi(a) + pk_hi(b)) >> 1);
+    return pk_pack(lo, hi);
+}
+
+static inline int16_t pk_sat16(int32_t v) {
+    return (int16_t)(v > 32767 ? 32767 : (v < -32768 ? -32768 : v));
+}
+
+// QADD16 / QSUB16: lane-wise add and subtract, saturating
+static inline Packed16 pk_emu_qadd16(Packed16 a, Packed16 b) {
+    return pk_pack(
+        pk_sat16((int32_t)pk_lo(a) + pk_lo(b)), pk_sat16((int32_t)pk_hi(a) + pk_hi(b)));
+}
+
+static inline Packed16 pk_emu_qsub16(Packed16 a, Packed16 b) {
+    return pk_pack(
+        pk_sat16((int32_t)pk_lo(a) - pk_lo(b)), pk_sat16((int32_t)pk_hi(a) - pk_hi(b)));
+}
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#define PK_HAVE_DSP 1
+#define pk_dsp_sadd16(a, b) __SADD16((a), (b))
+#define pk_dsp_ssub16(a, b) __SSUB16((a), (b))
+#define pk_dsp_smuad(a, b) ((int32_t)__SMUAD((a), (b)))
+#define pk_dsp_shadd16(a, b) __SHADD16((a), (b))
+#define pk_dsp_qadd16(a, b) __QADD16((a), (b))
+#define pk_dsp_qsub16(a, b) __QSUB16((a), (b))
+#else
+#define PK_HAVE_DSP 0
+#define pk_dsp_sadd16 pk_emu_sadd16
+#define pk_dsp_ssub16 pk_emu_ssub16
+#define pk_dsp_smuad pk_emu_smuad
+#define pk_dsp_shadd16 pk_emu_shadd16
+#define pk_dsp_qadd16 pk_emu_qadd16
+#define pk_dsp_qsub16 pk_emu_qsub16
+#endif
+
+// The kernels, written once against whichever intrinsic set is passed in
+#define PK_DEFINE_KERNELS(suffix, SADD16, SSUB16, SMUAD)                              \
+    static void pk_integrate_##suffix(Packed16* pos, const Packed16* vel, size_t n) { \
+        for(size_t i = 0; i < n; i++) {                                               \
+            pos[i] = SADD16(pos[i], vel[i]);                                          \
+        }                                                                             \
+    }                                                                                 \
+                                                                                      \
+    static inline bool pk_overlap_##suffix(Packed16 pa, Packed16 pb, int32_t r_sum) { \
+        Packed16 d = SSUB16(pb, pa);                                                  \
+        return SMUAD(d, d) <= r_sum * r_sum;                                          \
+    }
+
+PK_DEFINE_KERNELS(dsp, pk_dsp_sadd16, pk_dsp_ssub16, pk_dsp_smuad)
+PK_DEFINE_KERNELS(emu, pk_emu_sadd16, pk_emu_ssub16, pk_emu_smuad)
+
+// Damped 1D wave over n words of two int16 columns (column 2k low): v gets
+// a quarter of the Laplacian (the end columns mirror themselves), loses
+// v >> damp and h >> spring, then h += v, all saturating. A lane-wise
+// arithmetic shift is a logical shift, a mask and a sign flip.
+#define PK_DEFINE_WAVE(suffix, SSUB16, SHADD16, QADD16, QSUB16)                            \
+    static inline Packed16 pk_asr16_##suffix(Packed16 w, int s) {                        \
+        Packed16 keep = (0xFFFFu >> s) * 0x10001u;                                       \
+        Packed16 sign = (0x8000u >> s) * 0x10001u;                                       \
+        return SSUB16(((w >> s) & keep) ^ sign, sign);                                   \
+    }                                                                                    \
+                                                                                         \
+    static inline Packed16 pk_wave_word_##suffix(                                        \
+        Packed16 prev, Packed16 here, Packed16 next, Packed16* v, int damp, int spring) { \
+        Packed16 left = (here << 16) | (prev >> 16);                                     \
+        Packed16 right = (here >> 16) | (next << 16);                                    \
+        Packed16 pull = SHADD16(QSUB16(SHADD16(left, right), here), 0);                  \
+        Packed16 nv = QADD16(*v, pull);                                                  \
+        nv = QSUB16(nv, pk_asr16_##suffix(*v, damp));                                    \
+        nv = QSUB16(nv, pk_asr16_##suffix(here, spring));                                \
+        *v = nv;                                                                         \
+        return QADD16(here, nv);                                                         \
+    }                                                                                    \
+                                                                                         \
+    static void pk_wave_##suffix(Packed16* h, Packed16* v, size_t n, int damp, int spring) { \
+        Packed16 prev = h[0] << 16;                                                      \
+        for(size_t k = 0; k + 1 < n; k++) {                                              \
+            Packed16 here = h[k];                                                        \
+            h[k] = pk_wave_word_##suffix(prev, here, h[k + 1], &v[k], damp, spring);     \
+            prev = here;                                                                 \
+        }                                                                                \
+        h[n - 1] = pk_wave_word_##suffix(prev, h[n - 1], h[n - 1] >> 16, &v[n - 1], damp, spring); \
+    }
+
+PK_DEFINE_WAVE(dsp, pk_dsp_ssub16, pk_dsp_shadd16, pk_dsp_qadd16, pk_dsp_qsub16)
+PK_DEFINE_WAVE(emu, pk_emu_ssub16, pk_emu_shadd16, pk_emu_qadd16, pk_emu_qsub16)
+
+typedef struct {
+    Packed16 pos[PK_MAX_BODIES];
+    Packed16 vel[PK_MAX_BODIES]; // displacement this step, not px/s
+    int16_t radius[PK_MAX_BODIES];
+    float carry_x[PK_MAX_BODIES]; // displacement below one lane step, added
+    float carry_y[PK_MAX_BODIES]; // to the next step's so slow bodies keep up
+
+    // Last step, for the HUD
+    uint32_t kernel_cycles; // integrate + overlap kernels only
+    size_t kernel_bodies;
+} PackedWorld;
+
+static inline void pk_store_body(PackedWorld* pw, size_t i, const PhysicsBody* b) {
+    pw->pos[i] = pk_pack(pk_from_float(b->x), pk_from_float(b->y));
+}
+
+// Same contract as physics_integrate, positions advanced by the packed kernel
+static void physics_integrate_packed(
+    PackedWorld* pw,
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    float gravity_y,
+    const WorldBounds* bounds,
+    PhysicsStats* stats
+) {
+    const float TWO_PI = 6.2831853f;
+    uint64_t animating = 0;
+
+    for(size_t i = 0; i < count; i++) {
+        PhysicsBody* b = &bodies[i];
+        pk_store_body(pw, i, b);
+        pw->radius[i] = pk_from_float(b->radius);
+        pw->vel[i] = 0;
+
+        if(b->pop_anim_timer > 0) {
+            b->pop_anim_timer--;
+            animating |= 1ull << i;
+            continue;
+        }
+
+        if(b->inv_mass > 0.0f && !b->popped) {
+            b->vy += (b->ay + gravity_y) * dt;
+            b->vx += b->ax * dt;
+
+            b->wobble_phase += b->wobble_speed * dt;
+            if(b->wobble_phase > TWO_PI) b->wobble_phase -= TWO_PI;
+            float wobble = sinf(b->wobble_phase) * b->wobble_amplitude;
+
+            float dx = (b->vx + wobble) * dt + pw->carry_x[i];
+            float dy = b->vy * dt + pw->carry_y[i];
+            int16_t qx = pk_from_float(dx);
+            int16_t qy = pk_from_float(dy);
+            pw->carry_x[i] = dx - pk_to_float(qx);
+            pw->carry_y[i] = dy - pk_to_float(qy);
+            pw->vel[i] = pk_pack(qx, qy);
+        }
+    }
+
+    uint32_t start = perf_cycles();
+    pk_integrate_dsp(pw->pos, pw->vel, count);
+    pw->kernel_cycles = perf_cycles() - start;
+
+    for(size_t i = 0; i < count; i++) {
+        PhysicsBody* b = &bodies[i];
+        if(pw->vel[i]) {
+            b->x = pk_to_float(pk_lo(pw->pos[i]));
+            b->y = pk_to_float(pk_hi(pw->pos[i]));
+        }
+
+        if(animating & (1ull << i)) continue;
+
+        if(bounds) {
+            float r = b->radius;
+            if(b->x - r < bounds->min_x) {
+                b->x = bounds->min_x + r;
+                if(b->vx < 0.0f) {
+                    b->vx = -b->vx * b->restitution;
+                    sim_emit(SimEventWall, b, NULL);
+                }
+                pk_store_body(pw, i, b);
+            } else if(b->x + r > bounds->max_x) {
+                b->x = bounds->max_x - r;
+                if(b->vx > 0.0f) {
+                    b->vx = -b->vx * b->restitution;
+                    sim_emit(SimEventWall, b, NULL);
+                }
+                pk_store_body(pw, i, b);
+            }
+        }
+
+        stats->live_frames[b->group]++;
+        stats->cooldown_frames[b->group] += (b->spawn_cooldown > 0);
+        if(b->spawn_cooldown > 0) {
+            b->spawn_cooldown--;
+        }
+    }
+}
+
+// Naive pair loop with the packed overlap test as a prefilter; only pairs it
+// accepts reach the float resolver, which re-packs whatever it moved.
+static void physics_collide_packed(
+    PackedWorld* pw,
+    PhysicsBody* bodies,
+    size_t count,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    uint32_t kernel = 0;
+    PairFlags flags;
+    pair_flags_build(&flags, bodies, count, bounds);
+
+    for(size_t i = 0; i < count; i++) {
+        PhysicsBody* a = &bodies[i];
+        for(uint64_t cols = pair_flags_row(&flags, i); cols; cols &= cols - 1) {
+            size_t j = (size_t)__builtin_ctzll(cols);
+            PhysicsBody* b = &bodies[j];
+
+            uint32_t start = perf_cycles();
+            bool hit = pk_overlap_dsp(
+                pw->pos[i], pw->pos[j], pw->radius[i] + pw->radius[j] + PK_ROUND_SLOP);
+            kernel += perf_cycles() - start;
+            if(!hit) continue;
+
+            if(physics_resolve_pair(a, b, rng, stats)) {
+                pk_store_body(pw, i, a);
+                pk_store_body(pw, j, b);
+                pair_flags_touch(&flags, a, i, bounds);
+                pair_flags_touch(&flags, b, j, bounds);
+            }
+        }
+    }
+
+    pw->kernel_cycles += kernel;
+}
+
+static void physics_step_packed(
+    PackedWorld* pw,
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    float gravity_y,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(dt <= 0.0f) return;
+    if(!bodies || count == 0) return;
+    if(!stats) stats = &stats_sink;
+
+    if(count > PK_MAX_BODIES) {
+        physics_step(bodies, count, dt, gravity_y, bounds, rng, stats);
+        return;
+    }
+
+    physics_integrate_packed(pw, bodies, count, dt, gravity_y, bounds, stats);
+    physics_collide_packed(pw, bodies, count, bounds, rng, stats);
+    pw->kernel_bodies = count;
+}
+
+// Run both kernel flavours over the same pseudo-random lanes (including
+// values that wrap) and compare. The FNV-1a checksum of the outputs should be
+// identical on device and in any other build of these kernels.
+static bool pk_selftest(uint32_t* checksum) {
+    Packed16 pos_dsp[PK_MAX_BODIES];
+    Packed16 pos_emu[PK_MAX_BODIES];
+    Packed16 vel[PK_MAX_BODIES];
+    SimpleRng rng;
+    rng_init(&rng, 0xB0BB1E5u);
+
+    for(size_t i = 0; i < PK_MAX_BODIES; i++) {
+        pos_dsp[i] = pos_emu[i] = rng_next(&rng);
+        vel[i] = rng_next(&rng);
+    }
+    pos_dsp[0] = pos_emu[0] = pk_pack(32767, -32768);
+    vel[0] = pk_pack(1, -1);
+
+    bool ok = true;
+    uint32_t hash = 2166136261u;
+    for(int pass = 0; pass < 4; pass++) {
+        pk_integrate_dsp(pos_dsp, vel, PK_MAX_BODIES);
+        pk_integrate_emu(pos_emu, vel, PK_MAX_BODIES);
+        for(size_t i = 0; i + 1 < PK_MAX_BODIES; i++) {
+            int32_t r_sum = (int32_t)(vel[i] & 0x3FFFu);
+            bool hit_dsp = pk_overlap_dsp(pos_dsp[i], pos_dsp[i + 1], r_sum);
+            bool hit_emu = pk_overlap_emu(pos_emu[i], pos_emu[i + 1], r_sum);
+            if(hit_dsp != hit_emu || pos_dsp[i] != pos_emu[i]) ok = false;
+            hash = (hash ^ pos_dsp[i] ^ (uint32_t)hit_dsp) * 16777619u;
+        }
+    }
+
+    // The wave kernel, over the same lanes seen as heights and velocities
+    Packed16 v_dsp[PK_MAX_BODIES];
+    Packed16 v_emu[PK_MAX_BODIES];
+    memcpy(v_dsp, vel, sizeof(v_dsp));
+    memcpy(v_emu, vel, sizeof(v_emu));
+    for(int pass = 0; pass < 4; pass++) {
+        pk_wave_dsp(pos_dsp, v_dsp, PK_MAX_BODIES, 5, 7);
+        pk_wave_emu(pos_emu, v_emu, PK_MAX_BODIES, 5, 7);
+    }
+    for(size_t i = 0; i < PK_MAX_BODIES; i++) {
+        if(pos_dsp[i] != pos_emu[i] || v_dsp[i] != v_emu[i]) ok = false;
+        hash = (hash ^ pos_dsp[i] ^ v_dsp[i]) * 16777619u;
+    }
+
+    if(checksum) *checksum = hash;
+    return ok;
+}
+
+// --- Multi-rate stepping ----------------------------------------------------
+//
+// A large bubble rising at 4 px/s moves a tenth of a pixel per frame, yet
+// stepping integrates and collides it as often as a 60 px/s one. Here each
+// group gets a stride: integrate every 1, 2 or 4 frames with the time saved
+// up, chosen from its rise speed so one step moves it at most RATE_MAX_PX.
+// Bodies are spread over the frames by index. A body that is going faster
+// than its group's stride allows (after a hit, a blast or the cursor) drops
+// to a shorter one until it slows down again.
+//
+// A pair is tested only if at least one of the two was integrated this
+// frame; two bodies that both sat still can't have come any closer. Contacts
+// push bodies that weren't due, so those are integrated and tested the next
+// frame whatever their stride, which keeps fast-against-slow contacts as
+// tight as in Step.
+
+#define RATE_MAX_BODIES 64
+#define RATE_MAX_STRIDE 4 // power of two
+#define RATE_MAX_PX 1.0f  // at most this far per step, so the lag stays under a pixel
+
+typedef struct {
+    float group_speed[PHYSICS_MAX_GROUPS]; // nominal speed per group, set by the app
+    uint8_t stride[PHYSICS_MAX_GROUPS];    // frames per step, from group_speed
+    float debt[RATE_MAX_BODIES];           // simulated time not integrated yet
+    uint64_t awake;                        // pushed by a contact, step next frame
+    uint32_t frame;
+
+    // Totals: integrations done against body-frames (what Step would have
+    // done), and candidate pairs skipped because neither body moved
+    uint32_t body_steps;
+    uint32_t body_frames;
+    uint32_t skipped_pairs;
+} RateState;
+
+static void rate_reset(RateState* rs) {
+    memset(rs->debt, 0, sizeof(rs->debt));
+    rs->awake = 0;
+}
+
+// Body was moved outside the step (respawn): drop the time it saved up
+static void rate_touch(RateState* rs, size_t body) {
+    if(body < RATE_MAX_BODIES) rs->debt[body] = 0.0f;
+}
+
+// Body was nudged outside the step (constraints, foam) but is still where
+// its saved-up time left it: step it next frame, debt and all
+static void rate_wake(RateState* rs, size_t body) {
+    if(body < RATE_MAX_BODIES) rs->awake |= 1ull << body;
+}
+
+// Longest stride, up to max, that keeps a step at this speed within RATE_MAX_PX
+static uint8_t rate_stride_for(float speed, float dt, uint8_t max) {
+    uint8_t stride = max;
+    while(stride > 1 && speed * dt * (float)stride > RATE_MAX_PX) stride >>= 1;
+    return stride;
+}
+
+// physics_integrate's motion and wall bounce for one body over step seconds
+static void rate_move_body(
+    PhysicsBody* b,
+    float step,
+    float gravity_y,
+    const WorldBounds* bounds
+) {
+    const float TWO_PI = 6.2831853f;
+
+    if(b->inv_mass > 0.0f && !b->popped) {
+        b->vy += (b->ay + gravity_y) * step;
+        b->vx += b->ax * step;
+
+        b->wobble_phase += b->wobble_speed * step;
+        if(b->wobble_phase > TWO_PI) b->wobble_phase -= TWO_PI;
+        float wobble = sinf(b->wobble_phase) * b->wobble_amplitude;
+        b->x += wobble * step;
+
+        b->x += b->vx * step;
+        b->y += b->vy * step;
+    }
+
+    if(bounds) {
+        float r = b->radius;
+        if(b->x - r < bounds->min_x) {
+            b->x = bounds->min_x + r;
+            if(b->vx < 0.0f) {
+                b->vx = -b->vx * b->restitution;
+                sim_emit(SimEventWall, b, NULL);
+            }
+        } else if(b->x + r > bounds->max_x) {
+            b->x = bounds->max_x - r;
+            if(b->vx > 0.0f) {
+                b->vx = -b->vx * b->restitution;
+                sim_emit(SimEventWall, b, NULL);
+            }
+        }
+    }
+}
+
+// Bring every body up to date, e.g. before another mode takes over
+static void rate_settle(
+    RateState* rs,
+    PhysicsBody* bodies,
+    size_t count,
+    float gravity_y,
+    const WorldBounds* bounds
+) {
+    for(size_t i = 0; i < count && i < RATE_MAX_BODIES; i++) {
+        if(rs->debt[i] > 0.0f) rate_move_body(&bodies[i], rs->debt[i], gravity_y, bounds);
+        rs->debt[i] = 0.0f;
+    }
+}
+
+// Same per-body work as physics_integrate, for the bodies due this frame
+// with the time they saved up. Cooldowns and pop animations still tick
+// every frame. Returns the bodies that were integrated.
+static uint64_t physics_integrate_rate(
+    RateState* rs,
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    float gravity_y,
+    const WorldBounds* bounds,
+    PhysicsStats* stats
+) {
+    uint64_t due = 0;
+
+    for(int g = 0; g < PHYSICS_MAX_GROUPS; g++) {
+        rs->stride[g] = rate_stride_for(rs->group_speed[g], dt, RATE_MAX_STRIDE);
+    }
+
+    for(size_t i = 0; i < count; i++) {
+        PhysicsBody* b = &bodies[i];
+
+        if(b->pop_anim_timer > 0) {
+            b->pop_anim_timer--;
+            rs->debt[i] = 0.0f;
+            continue;
+        }
+
+        rs->body_frames++;
+        rs->debt[i] += dt;
+        uint8_t stride = rs->stride[b->group];
+        if(stride > 1 && !(rs->awake & (1ull << i))) {
+            // |vx| + |vy| bounds the speed from above without a square root
+            float speed = fabsf(b->vx) + fabsf(b->vy) + fabsf(b->wobble_amplitude);
+            stride = rate_stride_for(speed, dt, stride);
+        } else {
+            stride = 1;
+        }
+        if(((rs->frame + i) & (stride - 1u)) == 0) {
+            rate_move_body(b, rs->debt[i], gravity_y, bounds);
+            rs->debt[i] = 0.0f;
+            due |= 1ull << i;
+            rs->body_steps++;
+        }
+
+        stats->live_frames[b->group]++;
+        stats->cooldown_frames[b->group] += (b->spawn_cooldown > 0);
+        if(b->spawn_cooldown > 0) {
+            b->spawn_cooldown--;
+        }
+    }
+
+    rs->frame++;
+    return due;
+}
+
+// Same contract as physics_step_broadphase, with per-group strides
+static void physics_step_rate(
+    RateState* rs,
+    Broadphase* bp,
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    float gravity_y,
+    const WorldBounds* bounds,
+    SimpleRng* rng,
+    PhysicsStats* stats
+) {
+    if(dt <= 0.0f) return;
+    if(!bodies || count == 0) return;
+    if(!stats) stats = &stats_sink;
+
+    if(count > RATE_MAX_BODIES) {
+        physics_step_broadphase(bp, bodies, count, dt, gravity_y, bounds, rng, stats);
+        return;
+    }
+
+    uint64_t due = physics_integrate_rate(rs, bodies, count, dt, gravity_y, bounds, stats);
+    uint64_t awake = 0;
+    uint32_t skipped = 0;
+
+    if(broadphase_build(bp, bodies, count, bounds)) {
+        for(size_t p = 0; p < bp->pair_count; p++) {
+            size_t i = bp->pairs[p].a;
+            size_t j = bp->pairs[p].b;
+            if(!(due & ((1ull << i) | (1ull << j)))) {
+                skipped++;
+                continue;
+            }
+            if(bodies[i].popped || bodies[j].popped) continue;
+            if(physics_resolve_pair(&bodies[i], &bodies[j], rng, stats)) {
+                awake |= (1ull << i) | (1ull << j);
+            }
+        }
+    } else {
+        // Same flags as physics_collide_naive, behind the due test. A row
+        // whose body sat still only needs the columns that moved.
+        PairFlags flags;
+        pair_flags_build(&flags, bodies, count, bounds);
+        uint64_t all = count == 64 ? ~0ull : (1ull << count) - 1;
+
+        for(size_t i = 0; i < count; i++) {
+            PhysicsBody* a = &bodies[i];
+            if(a->popped || a->pop_anim_timer > 0) continue;
+            uint64_t bit = 1ull << i;
+            uint64_t cols = (due & bit) ? ~0ull : due;
+            skipped += (uint32_t)__builtin_popcountll(all & ~(bit | (bit - 1)) & ~cols);
+
+            for(uint64_t hot = pair_flags_row(&flags, i) & cols; hot; hot &= hot - 1) {
+                size_t j = (size_t)__builtin_ctzll(hot);
+                if(physics_resolve_pair(a, &bodies[j], rng, stats)) {
+                    awake |= bit | (1ull << j);
+                    pair_flags_touch(&flags, a, i, bounds);
+                    pair_flags_touch(&flags, &bodies[j], j, bounds);
+                }
+            }
+        }
+    }
+
+    rs->awake = awake;
+    rs->skipped_pairs += skipped;
+}
+
+// --- Bubble sim app ---------------------------------------------------------
+
+#define MAX_BODIES 48
+#define GROUP_COUNT 3
+#define SPAWN_COOLDOWN_FRAMES 10
+#define STATS_LOG_FRAMES 333 // ~10 s between stats lines on the log
+#define COMPARE_WORLDS 2
+#define LAYER_MAX 4
+
+_Static_assert(GROUP_COUNT <= PHYSICS_MAX_GROUPS, "stats arrays too small");
+
+typedef struct {
+    int count;          // number of bodies in this group
+    float radius;       // visual + collision radius
+    float rise_speed;   // base upward speed (negative vy, since y grows downward)
+    float restitution;  // bounciness 0..1
+    float pop_chance;   // chance to pop on collision
+    const char* name;   // not stored on disk
+} BubbleGroupConfig;
+
+// What gets written to disk (no pointers)
+typedef struct {
+    int count;
+    float radius;
+    float rise_speed;
+    float restitution;
+    float pop_chance;
+} BubbleGroupConfigDisk;
+
+typedef struct {
+    BubbleGroupConfigDisk groups[GROUP_COUNT];
+} BubbleConfig;
+
+typedef enum {
+    ConfigFieldCount = 0,
+    ConfigFieldRadius,
+    ConfigFieldSpeed,
+    ConfigFieldRestitution,
+    ConfigFieldPopChance,
+    ConfigFieldPhysics,    // app-wide, not per group
+    ConfigFieldCompare,    // app-wide: split screen A/B worlds
+    ConfigFieldLayers,     // app-wide: parallax depth layers
+    ConfigFieldRender,     // app-wide: where bodies get rasterized
+    ConfigFieldStyle,      // app-wide: outlines or shaded fills
+    ConfigFieldFizz,       // app-wide: background micro-bubble count
+    ConfigFieldWater,      // app-wide: rippling surface line at the top
+    ConfigFieldFoam,       // app-wide: bubbles pile up at the surface
+    ConfigFieldStick,      // app-wide: chance touching bubbles stick together
+    ConfigFieldBroadphase, // app-wide: pair finding for Step and Compare
+    ConfigFieldBlast,      // app-wide: pop blast radius, 0 = off
+    ConfigFieldChain,      // app-wide: chance a blast pops what it reaches
+    ConfigFieldCursor,     // app-wide: force field mode, OK takes the cursor
+    ConfigFieldFeedback,   // app-wide: pop clicks / vibration
+    ConfigFieldRecord,     // app-wide: record frames to the SD card
+    ConfigFieldBench,      // app-wide: pick a benchmark scenario, OK runs it
+    ConfigFieldCountEnum,
+} ConfigField;
+
+typedef enum {
+    PhysicsModeStep = 0, // naive pair loop every frame
+    PhysicsModeEvent,    // time-of-impact queue, steps when dense
+    PhysicsModePacked,   // int16 SIMD integrate + overlap prefilter
+    PhysicsModeRate,     // slow groups integrated every 2-4 frames
+    PhysicsModeCountEnum,
+} PhysicsMode;
+
+static const char* const physics_mode_names[PhysicsModeCountEnum] =
+    {"Step", "Event", "Packed", "Rate"};
+
+typedef enum {
+    RenderModeDirect = 0, // draw callback draws every body through the canvas
+    RenderModeAhead,      // app thread rasterizes, draw callback only blits
+    RenderModeCountEnum,
+} RenderMode;
+
+static const char* const render_mode_names[RenderModeCountEnum] = {"Direct", "Ahead"};
+
+typedef enum {
+    RenderStyleOutline = 0, // rings and a highlight dot
+    RenderStyleShaded,      // dithered fill with a clear highlight, one ring
+    RenderStyleCountEnum,
+} RenderStyle;
+
+static const char* const render_style_names[RenderStyleCountEnum] = {"Outline", "Shaded"};
+
+typedef enum {
+    CursorModeRepel = 0,
+    CursorModeAttract,
+    CursorModeCountEnum,
+} CursorMode;
+
+static const char* const cursor_mode_names[CursorModeCountEnum] = {"Repel", "Attract"};
+
+#define CURSOR_RADIUS 16.0f // px, cursor to rim
+#define CURSOR_ACCEL 240.0f // px/s^2 at the cursor
+#define CURSOR_SPEED 48.0f  // px/s while an arrow is held
+
+// Interactive cursor: the D-pad moves it while held, and bubbles within
+// CURSOR_RADIUS get a radial acceleration through ax/ay
+typedef struct {
+    bool active;
+    CursorMode mode;
+    float x;
+    float y;
+    uint8_t held;        // 1 << InputKey of the arrows held down
+    uint64_t pushed;     // bodies given a force last frame...
+    size_t pushed_first; // ...indexed from this body
+    uint32_t cycles;     // last frame's force pass, query included
+    uint8_t reached;     // bodies under the cursor last frame
+} BubbleCursor;
+
+typedef struct {
+    const char* name;
+    BroadphaseKind kind;
+    uint8_t cell_shift;
+} BroadphaseSetting;
+
+static const BroadphaseSetting broadphase_settings[] = {
+    {"Naive", BroadphaseNaive, 0},
+    {"Grid8", BroadphaseGrid, 3},
+    {"Grid16", BroadphaseGrid, 4},
+    {"Grid32", BroadphaseGrid, 5},
+    {"Bits", BroadphaseBitboard, BB_CELL_SHIFT},
+};
+
+#define BROADPHASE_SETTING_COUNT (sizeof(broadphase_settings) / sizeof(broadphase_settings[0]))
+
+typedef struct {
+    uint8_t fb[2][FB_SIZE];
+    volatile uint8_t front; // buffer the draw callback blits
+    volatile bool ready;    // front holds a finished frame
+    FuriMutex* mutex;       // held for the blit and for the flip, never while rasterizing
+} RenderAhead;
+
+// Fizz: 1 px micro-bubbles drawn behind the bodies, SoA, one packed word
+// per particle (see the Fizz particles section)
+#define FIZZ_MAX 2048
+
+typedef struct {
+    Packed16* pos;   // x | y << 16, lanes wrap at the screen edges
+    Packed16* vel;   // per frame
+    uint8_t* phase;  // into the shared wobble table
+    uint16_t count;  // live, 0 = off; the arrays stay allocated once used
+    uint16_t tick;
+    SimpleRng rng;   // own stream, so fizz never changes the simulation
+
+    // Last frame, for the perf page
+    uint32_t update_cycles;
+    uint32_t draw_cycles;
+} FizzLayer;
+
+// Water: a ripple line along the top of the screen, one int16 column per px
+// (see the Water surface section)
+typedef union {
+    int16_t col[SCREEN_W];
+    Packed16 pair[SCREEN_W / 2]; // col 2k | col 2k+1 << 16, for the wave kernel
+} WaterColumns;
+
+typedef struct {
+    bool on;
+    WaterColumns h;  // displacement, Q10 px, down is positive
+    WaterColumns v;  // Q10 px per frame
+    uint64_t below;  // bodies whose centre was under the line last frame
+    uint32_t splashes;
+
+    // Last frame, for the perf page
+    uint32_t update_cycles;
+    uint32_t draw_cycles;
+} WaterSurface;
+
+// A member's own settings while it sits in the foam, put back when it leaves
+typedef struct {
+    float pop_chance;
+    float restitution;
+    float wobble_amplitude;
+} FoamSaved;
+
+typedef struct {
+    bool on;
+    bool sleep;       // settled members go static; off only for benchmarks
+    uint64_t members; // bit per body held at the surface
+    uint64_t asleep;  // members that have settled
+    uint8_t still[MAX_BODIES]; // steps a member has stayed slow
+    uint16_t life[MAX_BODIES]; // steps until a member pops
+    FoamSaved saved[MAX_BODIES];
+    SimpleRng rng; // own stream, lifetimes only
+    uint32_t cycles; // last step
+} FoamState;
+
+_Static_assert(MAX_BODIES <= 64, "foam masks too small");
+
+#define STICK_MAX_EDGES 96 // constraint pool, two per body
+#define STICK_MAX_DEGREE 4 // edges per body
+
+typedef struct {
+    uint8_t a;
+    uint8_t b;
+    float rest; // px, centre to centre
+} StickEdge;
+
+typedef struct {
+    uint8_t chance_pct; // a bouncing pair sticks with this chance, 0 = off
+    StickEdge edges[STICK_MAX_EDGES]; // live ones packed at the front
+    size_t edge_count;
+    uint8_t degree[MAX_BODIES];
+    uint8_t parent[MAX_BODIES]; // union-find over the edges
+    uint8_t size[MAX_BODIES];   // cluster size, at roots
+    bool dirty;                 // edges broke since the last rebuild
+    uint64_t near[MAX_BODIES];  // proxy masks handed to the broadphase
+    SimpleRng rng;              // own stream, stick rolls only
+
+    // stick_build_proxies() scratch, kept here off the app thread's stack
+    struct {
+        uint8_t roots[MAX_BODIES];
+        uint8_t slot[MAX_BODIES]; // body -> its cluster, 0xFF when on its own
+        uint64_t members[MAX_BODIES];
+        uint64_t far[MAX_BODIES]; // bodies the proxy of cluster k clears
+        float cx[MAX_BODIES];
+        float cy[MAX_BODIES];
+        float cr[MAX_BODIES];
+    } proxy;
+
+    // stick_solve() cluster velocity sums, at the roots
+    struct {
+        float vx[MAX_BODIES];
+        float vy[MAX_BODIES];
+        uint8_t n[MAX_BODIES];
+    } solve;
+
+    uint8_t clusters;           // of two or more bodies
+    uint8_t largest;
+    uint32_t pool_full; // sticks refused for want of an edge
+    uint32_t cycles;    // last step, proxies and solve
+} StickState;
+
+static const uint16_t fizz_counts[] = {0, 256, 512, 1024, 2048};
+#define FIZZ_COUNT_STEPS (sizeof(fizz_counts) / sizeof(fizz_counts[0]))
+
+#define BENCH_MAX_FILES 32
+#define BENCH_NAME_LEN 24
+
+typedef enum {
+    RecModeOff = 0,
+    RecModeBodies, // body states every frame
+    RecModeScreen, // plus the render-ahead frame, when there is one
+    RecModeCountEnum,
+} RecMode;
+
+static const char* const rec_mode_names[RecModeCountEnum] = {"Off", "Bodies", "Screen"};
+
+// Recording file format, read by tools/bubble_trace.c (keep the two in
+// sync). A RecFileHeader, then per frame a RecFrameHeader, body_count
+// RecBody entries and, with REC_FRAME_SCREEN, FB_SIZE bytes of 1-bit screen
+// in the display layout. Little-endian, no padding.
+
+#define REC_MAGIC 0x43525342u // "BSRC"
+#define REC_VERSION 1
+#define REC_FRAME_SYNC 0xB5F7u // lets a reader resync after a torn write
+#define REC_FRAME_SCREEN 0x01
+#define REC_BODY_POPPED 0x01
+#define REC_BODY_ANIMATING 0x02
+#define REC_BODY_COOLDOWN 0x04
+#define REC_BUF_SIZE 4096 // written to SD whenever this fills
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size; // sizeof(RecFileHeader), readers skip the rest
+    uint16_t screen_w;
+    uint16_t screen_h;
+    uint32_t cycles_per_us;
+} RecFileHeader;
+
+typedef struct __attribute__((packed)) {
+    uint16_t sync;
+    uint8_t flags;
+    uint8_t body_count;
+    uint32_t frame;
+    uint32_t tick_ms;
+    uint32_t step_cycles;
+    uint32_t raster_cycles;
+} RecFrameHeader;
+
+typedef struct __attribute__((packed)) {
+    int16_t x;      // 1/16 px
+    int16_t y;      // 1/16 px
+    uint8_t radius; // 1/4 px
+    uint8_t group;
+    uint8_t flags;  // REC_BODY_*
+    uint8_t world;  // compare-mode world, else 0
+} RecBody;
+
+typedef struct {
+    RecMode mode;
+    Storage* storage;
+    File* file;
+    uint8_t buf[REC_BUF_SIZE];
+    size_t used;
+    uint32_t frame;
+    uint32_t bytes; // written to the file so far
+} BubbleRecorder;
+
+typedef enum {
+    FeedbackModeOff = 0,
+    FeedbackModeSound,
+    FeedbackModeVibro,
+    FeedbackModeBoth,
+    FeedbackModeLog, // play nothing, log what would have played
+    FeedbackModeCountEnum,
+} FeedbackMode;
+
+static const char* const feedback_mode_names[FeedbackModeCountEnum] = {
+    "Off", "Sound", "Vibro", "Both", "Log"};
+
+typedef struct {
+    uint32_t tick; // when the app thread asked
+    uint8_t pops;  // merged into this request, 0 = stop the worker
+    uint8_t mode;  // FeedbackMode
+} FeedbackRequest;
+
+typedef struct {
+    FeedbackMode mode;
+    FuriThread* thread;
+    FuriMessageQueue* queue;
+    File* log; // Log mode, opened and used by the worker only
+
+    // App thread
+    uint32_t clock_ms;  // simulated time, advanced by every flush
+    uint32_t last_sent; // clock_ms of the last request sent
+    uint8_t pending;    // pops waiting for the gap to pass
+    uint32_t requests;
+    uint32_t merged;  // pops folded into a request with others
+    uint32_t dropped; // requests lost to a full queue
+} BubbleFeedback;
+
+// Broadphase auto-tune: one off-screen measurement in flight, allocated
+// only while it runs (see the Broadphase auto-tune section)
+typedef struct {
+    uint32_t hash; // config being measured
+    PhysicsBody bodies[MAX_BODIES];
+    size_t count;
+    Broadphase bp;
+    SimpleRng rng;
+    size_t candidate; // index into broadphase_settings
+    uint16_t steps;   // done by the current candidate
+    uint16_t done[BROADPHASE_SETTING_COUNT]; // steps each candidate ran
+    uint32_t cycles[BROADPHASE_SETTING_COUNT];
+    uint32_t spent; // every candidate, against TUNE_CAP_MS
+} TuneRun;
+
+typedef struct {
+    TuneRun* run;
+    uint32_t hash;    // config the pick was made for, 0 = none yet
+    uint8_t pick;     // index into broadphase_settings
+    bool cached;      // read from the SD cache rather than measured
+    bool capped;      // measurement stopped at TUNE_CAP_MS
+    uint32_t pick_us; // per step while measured
+    uint32_t measured; // measurements this session
+} BubbleTuner;
+
+// Main loop tasks, in the order they run (see the Frame scheduler section)
+typedef enum {
+    SchedTaskInput = 0,
+    SchedTaskPhysics,
+    SchedTaskRender,
+    SchedTaskRecord,
+    SchedTaskFlush,
+    SchedTaskConfig,
+    SchedTaskStats,
+    SchedTaskTune,
+    SchedTaskCountEnum,
+} SchedTaskId;
+
+typedef struct {
+    bool pending;  // due, woken or part way through
+    uint8_t step;  // where a task that yielded picks up again
+    uint32_t next; // frame a periodic task is next due
+
+    uint32_t runs;
+    uint32_t overruns; // runs over budget
+    uint32_t deferred; // frames a background task waited for time
+
+    uint32_t window_cycles;
+    uint32_t window_max;
+    uint32_t avg_us; // per frame, last window
+    uint32_t max_us; // longest run, last window
+} SchedTask;
+
+typedef struct {
+    SchedTask tasks[SchedTaskCountEnum];
+    uint32_t frame;
+    uint32_t frame_cycles; // every task in the last frame
+} Scheduler;
+
+// Step time of each physics backend, measured while it was selected
+typedef struct {
+    uint32_t avg_cycles; // moving average
+    uint32_t frames;
+} BackendStats;
+
+typedef enum {
+    HudPageConfig = 0,
+    HudPagePerf,
+    HudPageStats,
+    HudPageTasks,
+    HudPageBackends,
+    HudPageHidden,
+    HudPageCountEnum,
+} HudPage;
+
+typedef struct {
+    Gui* gui;
+    ViewPort* view_port;
+    FuriMessageQueue* queue;
+
+    PhysicsBody bodies[MAX_BODIES];
+    size_t body_count;
+
+    WorldBounds bounds;
+    float gravity_y;
+
+    BubbleGroupConfig groups[GROUP_COUNT];
+    int selected_group;   // 0,1,2
+    ConfigField menu_field;
+
+    // Compare mode: bodies are split into two worlds, world 1 runs groups_b
+    bool compare;
+    PhysicsWorld worlds[COMPARE_WORLDS];
+    BubbleGroupConfig groups_b[GROUP_COUNT];
+    int edit_world; // which world's groups the HUD edits
+
+    // Depth layers: one world per layer over the whole screen, farthest
+    // first in app->bodies so drawing in order paints the front last
+    uint8_t layer_count; // 1 = off; Compare takes precedence
+    PhysicsWorld layers[LAYER_MAX];
+
+    SimpleRng rng;
+
+    PhysicsMode physics_mode;
+    ToiQueue toi;
+    PackedWorld packed;
+    RateState rate;
+    BackendStats backend_stats[PhysicsModeCountEnum];
+    Broadphase broad;
+    size_t broad_setting; // index into broadphase_settings
+    bool broad_auto;      // broad_setting is picked by the tuner
+    BubbleTuner tuner;
+    BlastConfig blast;
+    bool packed_selftest_ok;
+    uint32_t packed_checksum;
+    BubblePerf perf;
+    PhysicsStats stats; // since the last settings change
+
+    RenderMode render_mode;
+    RenderStyle render_style;
+    uint8_t render_overdraw; // benchmarks: bodies drawn this many times, 0 = once
+    RenderAhead render;
+    FizzLayer fizz;
+    WaterSurface water;
+    FoamState foam;
+    StickState stick;
+    BubbleCursor cursor;
+
+    BubbleRecorder rec;
+    BubbleFeedback feedback;
+
+    Scheduler sched;
+    uint8_t config_dirty;    // bit per world with unsaved group edits
+    uint32_t config_changed; // scheduler frame of the last edit
+
+    // Benchmark scenarios: bundled file names (without .scn), selection
+    // 0 = all of them, and progress of the run in flight for the HUD
+    char bench_files[BENCH_MAX_FILES][BENCH_NAME_LEN];
+    size_t bench_file_count;
+    size_t bench_selected;
+    bool bench_request; // OK on the Bench field, run from the main loop
+    const char* volatile bench_running;
+    volatile uint32_t bench_frame;
+    uint32_t bench_frames;
+
+    HudPage hud_page;     // long-press OK cycles pages; HudPageHidden hides the HUD
+} BubbleApp;
+
+typedef enum {
+    EventTypeInput,
+} BubbleEventType;
+
+typedef struct {
+    BubbleEventType type;
+    InputEvent input;
+} BubbleEvent;
+
+// --- Config save/load -------------------------------------------------------
+
+static void bubble_save_config(const BubbleGroupConfig* groups, const char* path) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    if(!storage) return;
+
+    // Ensure app data directory exists: /ext/apps_data/<appid>/
+    storage_common_mkdir(storage, APP_DATA_PATH(""));
+
+    File* file = storage_file_alloc(storage);
+    if(!file) {
+        furi_record_close(RECORD_STORAGE);
+        return;
+    }
+
+    // storage_file_open returns bool: true on success
+    if(storage_file_open(file, path, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        BubbleConfig cfg;
+
+        for(int i = 0; i < GROUP_COUNT; i++) {
+            cfg.groups[i].count = groups[i].count;
+            cfg.groups[i].radius = groups[i].radius;
+            cfg.groups[i].rise_speed = groups[i].rise_speed;
+            cfg.groups[i].restitution = groups[i].restitution;
+            cfg.groups[i].pop_chance = groups[i].pop_chance;
+        }
+
+        storage_file_write(file, &cfg, sizeof(cfg));
+        storage_file_sync(file);
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+}
+
+static void bubble_load_config(BubbleGroupConfig* groups, const char* path) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    if(!storage) return;
+
+    File* file = storage_file_alloc(storage);
+    if(!file) {
+        furi_record_close(RECORD_STORAGE);
+        return;
+    }
+
+    if(storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        BubbleConfig cfg;
+        size_t rd = storage_file_read(file, &cfg, sizeof(cfg));
+        if(rd == sizeof(cfg)) {
+            // Copy into runtime groups, preserving .name pointers
+            for(int i = 0; i < GROUP_COUNT; i++) {
+                groups[i].count = cfg.groups[i].count;
+                groups[i].radius = cfg.groups[i].radius;
+                groups[i].rise_speed = cfg.groups[i].rise_speed;
+                groups[i].restitution = cfg.groups[i].restitution;
+                groups[i].pop_chance = cfg.groups[i].pop_chance;
+            }
+        }
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+}
+
+// --- Stats output -----------------------------------------------------------
+
+static void bubble_format_group_stats(const BubbleApp* app, int g, char* buf, size_t size) {
+    const BubbleGroupConfig* cfg = &app->groups[g];
+    const PhysicsStats* st = &app->stats;
+    snprintf(
+        buf,
+        size,
+        "group=%s count=%d radius=%.2f speed=%.2f bounce=%.2f pop=%.2f "
+        "collisions=%lu pops=%lu respawns_top=%lu respawns_popped=%lu cooldown_frames=%lu "
+        "live_frames=%lu\n",
+        cfg->name,
+        cfg->count,
+        (double)cfg->radius,
+        (double)cfg->rise_speed,
+        (double)cfg->restitution,
+        (double)cfg->pop_chance,
+        (unsigned long)st->collisions[g],
+        (unsigned long)st->pops[g],
+        (unsigned long)st->respawns_top[g],
+        (unsigned long)st->respawns_popped[g],
+        (unsigned long)st->cooldown_frames[g],
+        (unsigned long)st->live_frames[g]);
+}
+
+static void bubble_format_session_stats(const BubbleApp* app, char* buf, size_t size) {
+    const PhysicsStats* st = &app->stats;
+    uint32_t per_step = st->steps ? (uint32_t)(st->physics_cycles / st->steps) : 0;
+    snprintf(
+        buf,
+        size,
+        "session physics=%s broadphase=%s%s steps=%lu physics_cycles=%llu cycles_per_step=%lu "
+        "pair_tests=%lu blast=%d chain=%d%% blast_queries=%lu chain_pops=%lu feedback=%s "
+        "feedback_requests=%lu feedback_merged=%lu feedback_dropped=%lu\n",
+        physics_mode_names[app->physics_mode],
+        broadphase_settings[app->broad_setting].name,
+        app->broad_auto ? "(auto)" : "",
+        (unsigned long)st->steps,
+        (unsigned long long)st->physics_cycles,
+        (unsigned long)per_step,
+        (unsigned long)st->pair_tests,
+        (int)app->blast.radius,
+        (int)(app->blast.chain_chance * 100.0f + 0.5f),
+        (unsigned long)st->blast_queries,
+        (unsigned long)st->chain_pops,
+        feedback_mode_names[app->feedback.mode],
+        (unsigned long)app->feedback.requests,
+        (unsigned long)app->feedback.merged,
+        (unsigned long)app->feedback.dropped);
+}
+
+// Stats over the log/serial path: one session line plus one per group
+static void bubble_log_stats(const BubbleApp* app) {
+    char buf[320];
+    bubble_format_session_stats(app, buf, sizeof(buf));
+    FURI_LOG_I(TAG, "%s", buf);
+    for(int g = 0; g < GROUP_COUNT; g++) {
+        bubble_format_group_stats(app, g, buf, sizeof(buf));
+        FURI_LOG_I(TAG, "%s", buf);
+    }
+}
+
+// Same lines appended to stats.txt, blank line between sessions
+static void bubble_save_stats(const BubbleApp* app) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    if(!storage) return;
+
+    storage_common_mkdir(storage, APP_DATA_PATH(""));
+
+    File* file = storage_file_alloc(storage);
+    if(!file) {
+        furi_record_close(RECORD_STORAGE);
+        return;
+    }
+
+    if(storage_file_open(file, BUBBLE_STATS_PATH, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        char buf[320];
+        bubble_format_session_stats(app, buf, sizeof(buf));
+        storage_file_write(file, buf, strlen(buf));
+        for(int g = 0; g < GROUP_COUNT; g++) {
+            bubble_format_group_stats(app, g, buf, sizeof(buf));
+            storage_file_write(file, buf, strlen(buf));
+        }
+        storage_file_write(file, "\n", 1);
+        storage_file_sync(file);
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+}
+
+// --- Bubble sim helpers -----------------------------------------------------
+
+static void bubble_init_default_groups(BubbleGroupConfig* groups) {
+    groups[0].name = "Small";
+    groups[0].count = 22;
+    groups[0].radius = 3.0f;
+    groups[0].rise_speed = 60.0f;
+    groups[0].restitution = 0.8f;
+    groups[0].pop_chance = 1.0f; // default: no popping?
+
+    groups[1].name = "Medium";
+    groups[1].count = 10;
+    groups[1].radius = 8.0f;
+    groups[1].rise_speed = 11.0f;
+    groups[1].restitution = 0.15f;
+    groups[1].pop_chance = 0.10f;
+
+    groups[2].name = "Large";
+    groups[2].count = 4;
+    groups[2].radius = 16.0f;
+    groups[2].rise_speed = 4.0f;
+    groups[2].restitution = 0.05f;
+    groups[2].pop_chance = 0.10f;
+}
+
+static BubbleGroupConfig* bubble_world_groups(BubbleApp* app, int world) {
+    return world ? app->groups_b : app->groups;
+}
+
+// Groups the HUD is currently editing
+static BubbleGroupConfig* bubble_edit_groups(BubbleApp* app) {
+    return bubble_world_groups(app, app->compare ? app->edit_world : 0);
+}
+
+static int bubble_world_of(const BubbleApp* app, size_t body_index) {
+    for(int w = COMPARE_WORLDS - 1; w > 0; w--) {
+        if(body_index >= app->worlds[w].first) return w;
+    }
+    return 0;
+}
+
+// Speed scale per depth, front first
+static const float layer_speed[LAYER_MAX] = {1.0f, 0.7f, 0.5f, 0.35f};
+static const uint8_t layer_counts[] = {1, 2, 4};
+#define LAYER_COUNT_STEPS (sizeof(layer_counts) / sizeof(layer_counts[0]))
+
+static bool bubble_layered(const BubbleApp* app) {
+    return !app->compare && app->layer_count > 1;
+}
+
+// Depth of a body, 0 = front. Layers are stored farthest first.
+static int bubble_layer_of(const BubbleApp* app, size_t body_index) {
+    int l = 0;
+    while(l + 1 < app->layer_count && body_index < app->layers[l].first) l++;
+    return l;
+}
+
+// Compare halves or depth layers; NULL when the bodies are a single world
+static PhysicsWorld* bubble_split_worlds(BubbleApp* app, size_t* count) {
+    if(app->compare) {
+        *count = COMPARE_WORLDS;
+        return app->worlds;
+    }
+    if(bubble_layered(app)) {
+        *count = app->layer_count;
+        return app->layers;
+    }
+    *count = 0;
+    return NULL;
+}
+
+// Split worlds always step with Step physics and the selected broadphase,
+// and have no single surface for the foam: while they are on, the Physics
+// and Foam fields show what runs and Left/Right leaves them alone. Returns
+// the setting that locks the field, or NULL.
+static const char* bubble_field_locked_by(const BubbleApp* app, ConfigField field) {
+    if(field != ConfigFieldPhysics && field != ConfigFieldFoam) return NULL;
+    if(app->compare) return "Compare";
+    if(bubble_layered(app)) return "Layers";
+    return NULL;
+}
+
+// --- Sticky clusters --------------------------------------------------------
+//
+// With Stick on, a pair that bounces (a Contact on the event bus) sticks
+// with the chosen chance: a distance constraint at touching length, from a
+// fixed pool of STICK_MAX_EDGES and at most STICK_MAX_DEGREE per body.
+// Union-find over the edges groups bodies into clusters. After each step a
+// few position-based passes pull every edge back to its length and cluster
+// members move part of the way to their cluster's average velocity, so a
+// cluster rises as one. A pop or respawn breaks every edge of that body and
+// an edge stretched past STICK_BREAK_PX snaps; broken edges rebuild the
+// union-find. Before the step each cluster's bounding circle becomes one
+// broadphase proxy, and bodies are only paired with bodies whose proxy
+// overlaps theirs: a cluster clear of everything costs a circle test per
+// proxy instead of a pair test per member.
+
+#define STICK_ITERATIONS 3
+#define STICK_BREAK_PX 4.0f     // stretch past the rest length that snaps an edge
+#define STICK_COHESION 0.5f     // share of the way to the cluster velocity per step
+#define STICK_PROXY_MARGIN 4.0f // px a proxy may move during the step it covers
+#define STICK_MOVED_PX 0.05f    // corrections below this aren't reported as moves
+#define STICK_MOVED_SPEED 0.5f  // nor velocity changes below this, px/s
+#define STICK_SEED 0x571CCu
+#define STICK_BUCKETS 5 // largest cluster 1, 2-3, 4-7, 8-15, 16+
+
+static const uint8_t stick_chances[] = {0, 10, 25, 50};
+#define STICK_CHANCE_STEPS (sizeof(stick_chances) / sizeof(stick_chances[0]))
+
+static uint8_t stick_find(StickState* st, uint8_t i) {
+    while(st->parent[i] != i) {
+        st->parent[i] = st->parent[st->parent[i]]; // path halving
+        i = st->parent[i];
+    }
+    return i;
+}
+
+static void stick_union(StickState* st, uint8_t a, uint8_t b) {
+    a = stick_find(st, a);
+    b = stick_find(st, b);
+    if(a == b) return;
+    if(st->size[a] < st->size[b]) {
+        uint8_t t = a;
+        a = b;
+        b = t;
+    }
+    st->parent[b] = a;
+    st->size[a] += st->size[b];
+}
+
+// Union-find from scratch; it can't split, so breaks end up here
+static void stick_rebuild(StickState* st) {
+    for(size_t i = 0; i < MAX_BODIES; i++) {
+        st->parent[i] = (uint8_t)i;
+        st->size[i] = 1;
+    }
+    for(size_t k = 0; k < st->edge_count; k++) {
+        stick_union(st, st->edges[k].a, st->edges[k].b);
+    }
+    st->dirty = false;
+}
+
+// Drop every edge; before the body array is rebuilt or reordered
+static void stick_reset(StickState* st) {
+    st->edge_count = 0;
+    memset(st->degree, 0, sizeof(st->degree));
+    stick_rebuild(st);
+    st->clusters = 0;
+    st->largest = 1;
+    rng_init(&st->rng, STICK_SEED);
+}
+
+// Edge k goes; the last one takes its slot
+static void stick_remove_edge(StickState* st, size_t k) {
+    st->degree[st->edges[k].a]--;
+    st->degree[st->edges[k].b]--;
+    st->edges[k] = st->edges[--st->edge_count];
+    st->dirty = true;
+}
+
+static void stick_break_body(StickState* st, size_t body) {
+    for(size_t k = 0; k < st->edge_count;) {
+        if(st->edges[k].a == body || st->edges[k].b == body) {
+            stick_remove_edge(st, k);
+        } else {
+            k++;
+        }
+    }
+}
+
+static void stick_add(StickState* st, const PhysicsBody* bodies, uint8_t a, uint8_t b) {
+    if(a == b || st->degree[a] >= STICK_MAX_DEGREE || st->degree[b] >= STICK_MAX_DEGREE) return;
+    for(size_t k = 0; k < st->edge_count; k++) {
+        const StickEdge* e = &st->edges[k];
+        if((e->a == a && e->b == b) || (e->a == b && e->b == a)) return;
+    }
+    if(st->edge_count == STICK_MAX_EDGES) {
+        st->pool_full++;
+        return;
+    }
+    st->edges[st->edge_count++] = (StickEdge){a, b, bodies[a].radius + bodies[b].radius};
+    st->degree[a]++;
+    st->degree[b]++;
+    if(!st->dirty) stick_union(st, a, b); // else the next rebuild has it
+}
+
+// Bounding circle per cluster, then near[i] for the pair loops. Bodies
+// outside clusters are their own proxy; they are tested against clusters
+// here but never against each other. False when there is nothing to cull.
+static bool stick_build_proxies(StickState* st, const PhysicsBody* bodies, size_t count) {
+    if(!st->clusters || count > MAX_BODIES) return false;
+    if(st->dirty) stick_rebuild(st);
+
+    uint8_t* roots = st->proxy.roots;
+    uint8_t* slot = st->proxy.slot;
+    uint64_t* members = st->proxy.members;
+    uint64_t* far = st->proxy.far;
+    float* cx = st->proxy.cx;
+    float* cy = st->proxy.cy;
+    float* cr = st->proxy.cr;
+    size_t k_count = 0;
+
+    for(size_t i = 0; i < count; i++) {
+        uint8_t r = stick_find(st, (uint8_t)i);
+        slot[i] = 0xFF;
+        if(st->size[r] < 2) continue;
+        size_t k = 0;
+        while(k < k_count && roots[k] != r) k++;
+        if(k == k_count) {
+            roots[k] = r;
+            members[k] = 0;
+            far[k] = 0;
+            cx[k] = 0.0f;
+            cy[k] = 0.0f;
+            k_count++;
+        }
+        slot[i] = (uint8_t)k;
+        members[k] |= 1ull << i;
+        cx[k] += bodies[i].x;
+        cy[k] += bodies[i].y;
+    }
+
+    for(size_t k = 0; k < k_count; k++) {
+        float n = (float)__builtin_popcountll(members[k]);
+        cx[k] /= n;
+        cy[k] /= n;
+        cr[k] = 0.0f;
+        for(uint64_t m = members[k]; m; m &= m - 1) {
+            const PhysicsBody* b = &bodies[__builtin_ctzll(m)];
+            float r = sqrtf(ph_len2(b->x - cx[k], b->y - cy[k])) + b->radius;
+            if(r > cr[k]) cr[k] = r;
+        }
+        cr[k] += STICK_PROXY_MARGIN;
+    }
+
+    uint64_t all = count == 64 ? ~0ull : (1ull << count) - 1;
+    for(size_t i = 0; i < count; i++) st->near[i] = all;
+
+    for(size_t k = 0; k < k_count; k++) {
+        for(size_t m = k + 1; m < k_count; m++) {
+            float reach = cr[k] + cr[m];
+            if(ph_len2(cx[m] - cx[k], cy[m] - cy[k]) <= reach * reach) continue;
+            far[k] |= members[m];
+            far[m] |= members[k];
+        }
+        for(size_t i = 0; i < count; i++) {
+            if(slot[i] != 0xFF) continue;
+            float reach = cr[k] + bodies[i].radius + STICK_PROXY_MARGIN;
+            if(ph_len2(bodies[i].x - cx[k], bodies[i].y - cy[k]) <= reach * reach) continue;
+            far[k] |= 1ull << i;
+            st->near[i] &= ~members[k];
+        }
+    }
+    for(size_t i = 0; i < count; i++) {
+        if(slot[i] != 0xFF) st->near[i] &= ~far[slot[i]];
+    }
+    return true;
+}
+
+// After the step: overstretched edges snap, the rest are pulled back to
+// length, and cluster members share their velocity. Returns the bodies it
+// moved or changed the velocity of by more than STICK_MOVED_PX/_SPEED;
+// members held at rest length aren't reported frame after frame.
+static uint64_t stick_solve(StickState* st, PhysicsBody* bodies, size_t count) {
+    for(size_t k = 0; k < st->edge_count;) {
+        const StickEdge* e = &st->edges[k];
+        float reach = e->rest + STICK_BREAK_PX;
+        float dx = bodies[e->b].x - bodies[e->a].x;
+        float dy = bodies[e->b].y - bodies[e->a].y;
+        if(ph_len2(dx, dy) > reach * reach) {
+            stick_remove_edge(st, k);
+        } else {
+            k++;
+        }
+    }
+    if(st->dirty) stick_rebuild(st);
+
+    uint64_t members = 0;
+    uint64_t moved = 0;
+    for(int pass = 0; pass < STICK_ITERATIONS; pass++) {
+        for(size_t k = 0; k < st->edge_count; k++) {
+            const StickEdge* e = &st->edges[k];
+            PhysicsBody* a = &bodies[e->a];
+            PhysicsBody* b = &bodies[e->b];
+            if(a->popped || b->popped) continue; // its pop event breaks it
+            float wa = a->inv_mass;
+            float wb = b->inv_mass;
+            if(wa + wb <= 0.0f) continue;
+
+            float dx = b->x - a->x;
+            float dy = b->y - a->y;
+            float dist = sqrtf(ph_len2(dx, dy));
+            if(dist < 0.001f) continue;
+            float stretch = dist - e->rest;
+            float c = stretch / (dist * (wa + wb));
+            a->x += dx * c * wa;
+            a->y += dy * c * wa;
+            b->x -= dx * c * wb;
+            b->y -= dy * c * wb;
+            members |= (1ull << e->a) | (1ull << e->b);
+            float shift = fabsf(stretch) / (wa + wb);
+            if(shift * wa > STICK_MOVED_PX) moved |= 1ull << e->a;
+            if(shift * wb > STICK_MOVED_PX) moved |= 1ull << e->b;
+        }
+    }
+
+    // Cluster velocity, summed at the roots; sizes for the HUD
+    float* vx = st->solve.vx;
+    float* vy = st->solve.vy;
+    uint8_t* n = st->solve.n;
+    memset(n, 0, count);
+    st->clusters = 0;
+    st->largest = 1;
+    for(size_t i = 0; i < count; i++) {
+        if(!st->degree[i]) continue;
+        uint8_t r = stick_find(st, (uint8_t)i);
+        if(!n[r]) {
+            vx[r] = 0.0f;
+            vy[r] = 0.0f;
+            st->clusters++;
+            if(st->size[r] > st->largest) st->largest = st->size[r];
+        }
+        vx[r] += bodies[i].vx;
+        vy[r] += bodies[i].vy;
+        n[r]++;
+    }
+    for(uint64_t m = members; m; m &= m - 1) {
+        size_t i = (size_t)__builtin_ctzll(m);
+        uint8_t r = stick_find(st, (uint8_t)i);
+        PhysicsBody* b = &bodies[i];
+        float dvx = (vx[r] / n[r] - b->vx) * STICK_COHESION;
+        float dvy = (vy[r] / n[r] - b->vy) * STICK_COHESION;
+        b->vx += dvx;
+        b->vy += dvy;
+        if(fabsf(dvx) + fabsf(dvy) > STICK_MOVED_SPEED) moved |= 1ull << i;
+    }
+    return moved;
+}
+
+// Contacts may stick; pops and respawns break the body's edges. Runs at the
+// bus dispatch after the step that produced the events.
+static void stick_on_event(const SimEvent* event, void* context) {
+    BubbleApp* app = context;
+    StickState* st = &app->stick;
+    if(event->kind != SimEventContact) {
+        stick_break_body(st, event->body);
+        return;
+    }
+    const PhysicsBody* a = &app->bodies[event->body];
+    const PhysicsBody* b = &app->bodies[event->other];
+    if(a->popped || b->popped) return;
+    if(rng_next(&st->rng) % 100u < st->chance_pct) stick_add(st, app->bodies, event->body, event->other);
+}
+
+// Listen to the bus only while on, so Off costs nothing
+static void stick_set_chance(BubbleApp* app, uint8_t pct) {
+    StickState* st = &app->stick;
+    uint8_t kinds = SIM_EVENT_BIT(SimEventContact) | SIM_EVENT_BIT(SimEventPop) |
+                    SIM_EVENT_BIT(SimEventRespawn);
+    if(!st->chance_pct && pct) {
+        sim_bus_subscribe(&sim_bus, kinds, stick_on_event, app);
+    } else if(st->chance_pct && !pct) {
+        sim_bus_unsubscribe(&sim_bus, stick_on_event, app);
+    }
+    st->chance_pct = pct;
+    st->pool_full = 0;
+    stick_reset(st);
+}
+
+// Step-time bucket of the largest cluster: 1, 2-3, 4-7, 8-15, 16+
+static size_t stick_bucket(uint8_t largest) {
+    size_t b = largest > 1 ? (size_t)(31 - __builtin_clz(largest)) : 0;
+    return b < STICK_BUCKETS ? b : STICK_BUCKETS - 1;
+}
+
+// --- Foam surface -----------------------------------------------------------
+//
+// With Foam on, the top of the screen is a surface instead of an exit. A
+// bubble that reaches it, or touches a bubble already there, joins the foam:
+// it stops wobbling and bouncing, a small lift holds it up against the
+// surface, and it pops after a random number of steps. Foam is dense resting
+// contact, so after the regular step it gets a few projection passes of its
+// own that remove overlap and closing velocity without adding bounce. A
+// member that stays slow for FOAM_SLEEP_STEPS goes to sleep: it turns static
+// (inv_mass 0), which the pair loops skip against other static bodies, and
+// rising bubbles rest against it. Members that move wake the sleeping ones
+// they touch, and a pop wakes those around it, so holes close up.
+
+#define FOAM_SEED 0x0F0A3u
+#define FOAM_ITERATIONS 4
+#define FOAM_SLOP 0.05f       // px of overlap left alone, so resting pairs stay put
+#define FOAM_RELAX 0.8f       // share of the remaining overlap removed per pass
+#define FOAM_LIFT 90.0f       // px/s^2 upward on awake members
+#define FOAM_DAMPING 0.8f     // velocity kept per step by awake members
+#define FOAM_FRICTION 0.5f    // share of the sliding speed a contact takes out
+#define FOAM_JOIN_GAP 0.5f    // px: touching the surface or a member
+#define FOAM_WAKE_GAP 2.0f    // px beyond touching that a mover or a pop wakes
+#define FOAM_SLEEP_SPEED 3.0f // px/s
+#define FOAM_WAKE_SPEED 6.0f  // px/s, a member this fast wakes what it touches
+#define FOAM_SLEEP_STEPS 15
+#define FOAM_LIFE_MIN 600 // steps
+#define FOAM_LIFE_SPREAD 600
+
+static void foam_wake(FoamState* fs, PhysicsBody* b, size_t i) {
+    fs->asleep &= ~(1ull << i);
+    fs->still[i] = 0;
+    b->inv_mass = 1.0f;
+}
+
+static void foam_join(FoamState* fs, PhysicsBody* b, size_t i) {
+    fs->members |= 1ull << i;
+    fs->still[i] = 0;
+    fs->life[i] = (uint16_t)(FOAM_LIFE_MIN + rng_next(&fs->rng) % FOAM_LIFE_SPREAD);
+    fs->saved[i] = (FoamSaved){b->pop_chance, b->restitution, b->wobble_amplitude};
+    b->pop_chance = 0.0f; // foam pops of age, not on contact
+    b->restitution = 0.0f;
+    b->wobble_amplitude = 0.0f;
+    b->vx = 0.0f; // the foam soaks up its momentum
+    b->vy = 0.0f;
+}
+
+// Member i leaves the foam awake, with its own settings back
+static void foam_leave(FoamState* fs, PhysicsBody* b, size_t i) {
+    foam_wake(fs, b, i);
+    fs->members &= ~(1ull << i);
+    b->pop_chance = fs->saved[i].pop_chance;
+    b->restitution = fs->saved[i].restitution;
+    b->wobble_amplitude = fs->saved[i].wobble_amplitude;
+}
+
+// Release every member; before the body array is rebuilt or reordered
+static void foam_reset(FoamState* fs, PhysicsBody* bodies, size_t count) {
+    for(size_t i = 0; i < count; i++) {
+        if(fs->members & (1ull << i)) foam_leave(fs, &bodies[i], i);
+    }
+    fs->members = 0;
+    fs->asleep = 0;
+    rng_init(&fs->rng, FOAM_SEED);
+}
+
+static bool foam_touching(const PhysicsBody* a, const PhysicsBody* b, float gap) {
+    float r = a->radius + b->radius + gap;
+    return ph_len2(b->x - a->x, b->y - a->y) <= r * r;
+}
+
+static void foam_wake_near(FoamState* fs, PhysicsBody* bodies, size_t i) {
+    for(uint64_t m = fs->asleep; m; m &= m - 1) {
+        size_t j = (size_t)__builtin_ctzll(m);
+        if(foam_touching(&bodies[i], &bodies[j], FOAM_WAKE_GAP)) foam_wake(fs, &bodies[j], j);
+    }
+}
+
+// Push one overlapping pair apart and drop the velocity that closes it;
+// a is awake, b moves too unless it is asleep
+static void foam_contact(PhysicsBody* a, PhysicsBody* b, bool b_moves) {
+    float dx = b->x - a->x;
+    float dy = b->y - a->y;
+    float r_sum = a->radius + b->radius;
+    float dist2 = ph_len2(dx, dy);
+    if(dist2 >= r_sum * r_sum) return;
+
+    float dist = sqrtf(dist2);
+    float nx = 0.0f;
+    float ny = 1.0f; // dead centre: stack them
+    if(dist > 0.001f) {
+        nx = dx / dist;
+        ny = dy / dist;
+    }
+
+    float overlap = r_sum - dist - FOAM_SLOP;
+    if(overlap > 0.0f) {
+        float push = overlap * FOAM_RELAX;
+        if(b_moves) {
+            push *= 0.5f;
+            b->x += nx * push;
+            b->y += ny * push;
+        }
+        a->x -= nx * push;
+        a->y -= ny * push;
+    }
+
+    // Closing speed goes, and FOAM_FRICTION of the sliding speed with it
+    float rvx = b->vx - a->vx;
+    float rvy = b->vy - a->vy;
+    float vn = rvx * nx + rvy * ny;
+    float dvx = (rvx - vn * nx) * FOAM_FRICTION;
+    float dvy = (rvy - vn * ny) * FOAM_FRICTION;
+    if(vn < 0.0f) {
+        dvx += vn * nx;
+        dvy += vn * ny;
+    }
+    if(b_moves) {
+        dvx *= 0.5f;
+        dvy *= 0.5f;
+        b->vx -= dvx;
+        b->vy -= dvy;
+    }
+    a->vx += dvx;
+    a->vy += dvy;
+}
+
+// After the physics step: age and pop members, take in new ones, then the
+// resting-contact passes and sleep. Returns the bodies it moved or changed.
+static uint64_t foam_step(
+    FoamState* fs,
+    PhysicsBody* bodies,
+    size_t count,
+    float dt,
+    const WorldBounds* bounds,
+    PhysicsStats* stats
+) {
+    uint32_t start = perf_cycles();
+    uint64_t touched = 0;
+    float top = bounds->min_y;
+
+    // 1) Members pop of old age, or were popped by a contact or a blast
+    for(uint64_t m = fs->members; m; m &= m - 1) {
+        size_t i = (size_t)__builtin_ctzll(m);
+        PhysicsBody* b = &bodies[i];
+        if(!b->popped && --fs->life[i] == 0) {
+            b->popped = true;
+            b->pop_anim_timer = POP_ANIM_FRAMES;
+            stats->pops[b->group]++;
+            sim_emit(SimEventPop, b, NULL);
+        }
+        if(b->popped) {
+            foam_leave(fs, b, i);
+            foam_wake_near(fs, bodies, i);
+            touched |= 1ull << i;
+        }
+    }
+
+    // 2) Bubbles at the surface or against a member join
+    for(size_t i = 0; i < count; i++) {
+        uint64_t bit = 1ull << i;
+        PhysicsBody* b = &bodies[i];
+        if((fs->members & bit) || b->popped || b->pop_anim_timer > 0) continue;
+
+        bool join = b->y - b->radius <= top + FOAM_JOIN_GAP;
+        for(uint64_t m = fs->members; m && !join; m &= m - 1) {
+            join = foam_touching(b, &bodies[__builtin_ctzll(m)], FOAM_JOIN_GAP);
+        }
+        if(join) {
+            foam_join(fs, b, i);
+            touched |= bit;
+        }
+    }
+
+    // 3) Awake members against the surface, each other (each pair once) and
+    // the asleep ones, which don't move
+    uint64_t awake = fs->members & ~fs->asleep;
+    for(int pass = 0; awake && pass < FOAM_ITERATIONS; pass++) {
+        for(uint64_t m = awake; m; m &= m - 1) {
+            size_t i = (size_t)__builtin_ctzll(m);
+            PhysicsBody* a = &bodies[i];
+            if(a->y - a->radius < top) {
+                a->y = top + a->radius;
+                if(a->vy < 0.0f) a->vy = 0.0f;
+            }
+
+            uint64_t cols = fs->members & ~(awake & ((2ull << i) - 1));
+            for(; cols; cols &= cols - 1) {
+                size_t j = (size_t)__builtin_ctzll(cols);
+                foam_contact(a, &bodies[j], !(fs->asleep & (1ull << j)));
+            }
+        }
+    }
+
+    // 4) Lift and damping; slow members fall asleep, moving ones wake the
+    // sleeping members they touch
+    for(uint64_t m = awake; m; m &= m - 1) {
+        size_t i = (size_t)__builtin_ctzll(m);
+        PhysicsBody* b = &bodies[i];
+        touched |= 1ull << i;
+
+        float speed2 = ph_len2(b->vx, b->vy);
+        b->vx *= FOAM_DAMPING;
+        b->vy = (b->vy - FOAM_LIFT * dt) * FOAM_DAMPING;
+        if(speed2 > FOAM_SLEEP_SPEED * FOAM_SLEEP_SPEED) {
+            fs->still[i] = 0;
+            if(speed2 > FOAM_WAKE_SPEED * FOAM_WAKE_SPEED) foam_wake_near(fs, bodies, i);
+        } else if(fs->sleep && ++fs->still[i] >= FOAM_SLEEP_STEPS) {
+            fs->asleep |= 1ull << i;
+            b->inv_mass = 0.0f;
+            b->vx = 0.0f;
+            b->vy = 0.0f;
+        }
+    }
+
+    fs->cycles = perf_cycles() - start;
+    return touched;
+}
+
+// Helper: initialize wobble parameters for a bubble
+static void bubble_init_wobble(SimpleRng* rng, PhysicsBody* b) {
+    // Slightly stronger wobble for larger groups
+    float base_amp = 1.0f + (float)b->group; // 1,2,3 by group
+    b->wobble_phase = rng_next_float01(rng) * 6.2831853f;
+    b->wobble_speed = 0.5f + rng_next_float01(rng) * 0.7f; // 0.5–1.2 rad/s
+    b->wobble_amplitude = base_amp;
+}
+
+// Put a body well below the screen with a fresh rise velocity, spawn
+// cooldown and wobble. Shape/material fields are left alone.
+static void bubble_place_body(
+    PhysicsBody* b,
+    const BubbleGroupConfig* cfg,
+    const WorldBounds* bounds,
+    SimpleRng* rng
+) {
+    float r = b->radius;
+
+    // random horizontal position
+    float x = (float)(bounds->min_x + r) +
+              rng_next_float01(rng) * (float)((bounds->max_x - r) - (bounds->min_x + r));
+
+    // spawn well below the bottom to avoid visible jitter
+    float y_base = bounds->max_y + r + 40.0f;
+    float y = y_base + rng_next_float01(rng) * 20.0f;
+
+    b->x = x;
+    b->y = y;
+
+    // Upward velocity (negative in screen coords)
+    float jitter = (rng_next_float01(rng) - 0.5f) * cfg->rise_speed * 0.2f;
+    b->vx = jitter;
+    b->vy = -cfg->rise_speed;
+
+    b->ax = 0.0f;
+    b->ay = 0.0f;
+    b->spawn_cooldown = SPAWN_COOLDOWN_FRAMES;
+    b->popped = false;
+    b->pop_anim_timer = 0;
+
+    bubble_init_wobble(rng, b);
+}
+
+static void bubble_init_body(
+    PhysicsBody* b,
+    const BubbleGroupConfig* cfg,
+    int group,
+    const WorldBounds* bounds,
+    SimpleRng* rng
+) {
+    b->radius = cfg->radius;
+    b->inv_mass = 1.0f; // all dynamic
+    b->restitution = cfg->restitution;
+    b->group = group;
+    b->pop_chance = cfg->pop_chance;
+
+    bubble_place_body(b, cfg, bounds, rng);
+}
+
+// Compare mode: two half-width worlds back to back in app->bodies, same seed,
+// each with its own group config. A world whose counts don't fit its half of
+// the body array has every group scaled down proportionally.
+static void bubble_app_build_compare(BubbleApp* app) {
+    uint32_t seed = rng_next(&app->rng);
+    const size_t capacity = MAX_BODIES / COMPARE_WORLDS;
+
+    for(int w = 0; w < COMPARE_WORLDS; w++) {
+        PhysicsWorld* world = &app->worlds[w];
+        const BubbleGroupConfig* groups = bubble_world_groups(app, w);
+
+        world->first = app->body_count;
+        world->bounds = app->bounds;
+        world->bounds.min_x = (float)(w * SCREEN_W / COMPARE_WORLDS);
+        world->bounds.max_x = (float)((w + 1) * SCREEN_W / COMPARE_WORLDS - 1);
+        rng_init(&world->rng, seed);
+
+        size_t total = 0;
+        for(int g = 0; g < GROUP_COUNT; g++) {
+            if(groups[g].count > 0) total += (size_t)groups[g].count;
+        }
+
+        for(int g = 0; g < GROUP_COUNT; g++) {
+            size_t count = groups[g].count > 0 ? (size_t)groups[g].count : 0;
+            if(total > capacity) count = count * capacity / total;
+
+            for(size_t i = 0; i < count; i++) {
+                PhysicsBody* b = &app->bodies[app->body_count++];
+                bubble_init_body(b, &groups[g], g, &world->bounds, &world->rng);
+            }
+        }
+
+        world->count = app->body_count - world->first;
+    }
+}
+
+// A body placed in a layer moves at that layer's speed
+static void bubble_layer_scale(PhysicsBody* b, int layer) {
+    b->vx *= layer_speed[layer];
+    b->vy *= layer_speed[layer];
+}
+
+// Depth layers: every group is dealt out across the layers, farthest layer
+// first. Each layer is its own full-screen world, so bubbles only meet
+// bubbles at their own depth, and rise at that depth's speed.
+static void bubble_app_build_layers(BubbleApp* app) {
+    int layers = app->layer_count;
+    for(int l = layers - 1; l >= 0; l--) {
+        PhysicsWorld* world = &app->layers[l];
+        world->first = app->body_count;
+        world->bounds = app->bounds;
+        rng_init(&world->rng, rng_next(&app->rng));
+
+        for(int g = 0; g < GROUP_COUNT; g++) {
+            int count = app->groups[g].count > 0 ? app->groups[g].count : 0;
+            int share = count / layers + (l < count % layers ? 1 : 0);
+            for(int i = 0; i < share && app->body_count < MAX_BODIES; i++) {
+                PhysicsBody* b = &app->bodies[app->body_count++];
+                bubble_init_body(b, &app->groups[g], g, &world->bounds, &world->rng);
+                bubble_layer_scale(b, l);
+            }
+        }
+
+        world->count = app->body_count - world->first;
+    }
+}
+
+// Rebuild all bodies based on group configs
+// Multi-rate strides follow the rise speeds; body slots are about to change
+static void bubble_rate_reset(BubbleApp* app) {
+    rate_reset(&app->rate);
+    for(int g = 0; g < GROUP_COUNT; g++) {
+        app->rate.group_speed[g] = app->groups[g].rise_speed;
+    }
+}
+
+static void bubble_app_build_bodies(BubbleApp* app) {
+    foam_reset(&app->foam, app->bodies, app->body_count);
+    stick_reset(&app->stick);
+    app->body_count = 0;
+    toi_invalidate(&app->toi);
+    bubble_rate_reset(app);
+
+    if(app->compare) {
+        bubble_app_build_compare(app);
+        return;
+    }
+    if(bubble_layered(app)) {
+        bubble_app_build_layers(app);
+        return;
+    }
+
+    for(int g = 0; g < GROUP_COUNT; g++) {
+        BubbleGroupConfig* cfg = &app->groups[g];
+        int count = cfg->count;
+        if(count < 0) count = 0;
+
+        for(int i = 0; i < count && app->body_count < MAX_BODIES; i++) {
+            PhysicsBody* b = &app->bodies[app->body_count++];
+            bubble_init_body(b, cfg, g, &app->bounds, &app->rng);
+        }
+    }
+}
+
+// Reinitialize only a single group's bodies
+static void bubble_app_reinit_group(BubbleApp* app, int group_id) {
+    if(group_id < 0 || group_id >= GROUP_COUNT) return;
+
+    // Compare runs restart both worlds from the shared seed on any change;
+    // layers deal every group out again
+    if(app->compare || bubble_layered(app)) {
+        bubble_app_build_bodies(app);
+        return;
+    }
+
+    BubbleGroupConfig* cfg = &app->groups[group_id];
+
+    // Body indices shift below, so any scheduled contacts are meaningless
+    toi_invalidate(&app->toi);
+    bubble_rate_reset(app);
+    foam_reset(&app->foam, app->bodies, app->body_count);
+    stick_reset(&app->stick);
+
+    // First, remove existing bodies of this group
+    size_t write = 0;
+    for(size_t i = 0; i < app->body_count; i++) {
+        if(app->bodies[i].group == group_id) continue;
+        if(write != i) app->bodies[write] = app->bodies[i];
+        write++;
+    }
+    app->body_count = write;
+
+    // Add new ones based on updated config
+    int count = cfg->count;
+    if(count < 0) count = 0;
+
+    for(int i = 0; i < count && app->body_count < MAX_BODIES; i++) {
+        PhysicsBody* b = &app->bodies[app->body_count++];
+        bubble_init_body(b, cfg, group_id, &app->bounds, &app->rng);
+    }
+}
+
+// Respawn a single bubble well below the screen (of its own world)
+static void bubble_respawn_body(BubbleApp* app, PhysicsBody* b) {
+    if(app->compare) {
+        int w = bubble_world_of(app, (size_t)(b - app->bodies));
+        PhysicsWorld* world = &app->worlds[w];
+        bubble_place_body(
+            b, &bubble_world_groups(app, w)[b->group], &world->bounds, &world->rng);
+        return;
+    }
+    if(bubble_layered(app)) {
+        int l = bubble_layer_of(app, (size_t)(b - app->bodies));
+        PhysicsWorld* world = &app->layers[l];
+        bubble_place_body(b, &app->groups[b->group], &world->bounds, &world->rng);
+        bubble_layer_scale(b, l);
+        return;
+    }
+
+    bubble_place_body(b, &app->groups[b->group], &app->bounds, &app->rng);
+}
+
+// --- Physics backends -------------------------------------------------------
+//
+// Each physics mode is a backend: its step over app->bodies, hooks for being
+// switched to and away from, and its line on the perf page. They all share
+// the one PhysicsBody array, so a switch keeps every bubble where it is and
+// only settles or drops the mode's own caches. Spatial queries need no
+// entry: bubble_query_index serves every backend from the same grid. While a
+// backend runs, its step time is averaged for the Backends HUD page, so the
+// modes can be compared on the device by switching back and forth.
+
+typedef struct {
+    void (*step)(BubbleApp* app, float dt);
+    void (*enter)(BubbleApp* app); // optional
+    void (*leave)(BubbleApp* app); // optional
+    void (*describe)(const BubbleApp* app, char* buf, size_t size);
+} PhysicsBackend;
+
+static void backend_step_broadphase(BubbleApp* app, float dt) {
+    physics_step_broadphase(
+        &app->broad,
+        app->bodies,
+        app->body_count,
+        dt,
+        app->gravity_y,
+        &app->bounds,
+        &app->rng,
+        &app->stats);
+}
+
+// Broadphase, pair tests and its own build time
+static void backend_describe_broadphase(const BubbleApp* app, char* buf, size_t size) {
+    const Broadphase* bp = &app->broad;
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+    snprintf(
+        buf,
+        size,
+        "%s %s%s pt%lu bp%luus",
+        physics_mode_names[app->physics_mode],
+        broadphase_settings[app->broad_setting].name,
+        bp->fell_back && bp->kind != BroadphaseNaive ? "!" : "",
+        (unsigned long)app->perf.step_pair_tests,
+        (unsigned long)(bp->kind != BroadphaseNaive ? bp->build_cycles / cpu : 0));
+}
+
+static void backend_step_events(BubbleApp* app, float dt) {
+    physics_step_events(
+        &app->toi,
+        app->bodies,
+        app->body_count,
+        dt,
+        app->gravity_y,
+        &app->bounds,
+        &app->rng,
+        &app->stats);
+}
+
+// The queue was last valid for whatever the bodies did before the switch
+static void backend_enter_events(BubbleApp* app) {
+    toi_invalidate(&app->toi);
+    app->toi.backoff = 0;
+}
+
+static void backend_describe_events(const BubbleApp* app, char* buf, size_t size) {
+    const char* mode = physics_mode_names[app->physics_mode];
+    if(app->toi.last_stepped) {
+        snprintf(buf, size, "%s (dense)", mode);
+    } else {
+        snprintf(buf, size, "%s ev=%u", mode, (unsigned)app->toi.last_events);
+    }
+}
+
+static void backend_step_packed(BubbleApp* app, float dt) {
+    physics_step_packed(
+        &app->packed,
+        app->bodies,
+        app->body_count,
+        dt,
+        app->gravity_y,
+        &app->bounds,
+        &app->rng,
+        &app->stats);
+}
+
+static void backend_enter_packed(BubbleApp* app) {
+    memset(app->packed.carry_x, 0, sizeof(app->packed.carry_x));
+    memset(app->packed.carry_y, 0, sizeof(app->packed.carry_y));
+}
+
+static void backend_describe_packed(const BubbleApp* app, char* buf, size_t size) {
+    size_t n = app->packed.kernel_bodies ? app->packed.kernel_bodies : 1;
+    snprintf(
+        buf,
+        size,
+        "%s %s %s %lucyc/b",
+        physics_mode_names[app->physics_mode],
+        PK_HAVE_DSP ? "dsp" : "emu",
+        app->packed_selftest_ok ? "ok" : "BAD",
+        (unsigned long)(app->packed.kernel_cycles / n));
+}
+
+static void backend_step_rate(BubbleApp* app, float dt) {
+    physics_step_rate(
+        &app->rate,
+        &app->broad,
+        app->bodies,
+        app->body_count,
+        dt,
+        app->gravity_y,
+        &app->bounds,
+        &app->rng,
+        &app->stats);
+}
+
+static void backend_enter_rate(BubbleApp* app) {
+    bubble_rate_reset(app);
+}
+
+// Slow bubbles may be a few frames behind; catch them up before handing over
+static void backend_leave_rate(BubbleApp* app) {
+    rate_settle(&app->rate, app->bodies, app->body_count, app->gravity_y, &app->bounds);
+}
+
+// Group strides and the share of Step's integrations actually done
+static void backend_describe_rate(const BubbleApp* app, char* buf, size_t size) {
+    const RateState* rs = &app->rate;
+    snprintf(
+        buf,
+        size,
+        "%s %u/%u/%u int%lu%% pt%lu",
+        physics_mode_names[app->physics_mode],
+        (unsigned)rs->stride[0],
+        (unsigned)rs->stride[1],
+        (unsigned)rs->stride[2],
+        (unsigned long)(rs->body_frames ? rs->body_steps * 100ull / rs->body_frames : 100),
+        (unsigned long)app->perf.step_pair_tests);
+}
+
+static const PhysicsBackend physics_backends[PhysicsModeCountEnum] = {
+    [PhysicsModeStep] = {backend_step_broadphase, NULL, NULL, backend_describe_broadphase},
+    [PhysicsModeEvent] =
+        {backend_step_events, backend_enter_events, NULL, backend_describe_events},
+    [PhysicsModePacked] =
+        {backend_step_packed, backend_enter_packed, NULL, backend_describe_packed},
+    [PhysicsModeRate] =
+        {backend_step_rate, backend_enter_rate, backend_leave_rate, backend_describe_rate},
+};
+
+static void bubble_set_backend(BubbleApp* app, PhysicsMode mode) {
+    const PhysicsBackend* from = &physics_backends[app->physics_mode];
+    if(from->leave) from->leave(app);
+    app->physics_mode = mode;
+    if(physics_backends[mode].enter) physics_backends[mode].enter(app);
+    memset(&app->stats, 0, sizeof(app->stats));
+}
+
+// Moving average over ~16 steps of the backend that just ran
+static void bubble_backend_record(BubbleApp* app, uint32_t cycles) {
+    BackendStats* bs = &app->backend_stats[app->physics_mode];
+    if(bs->frames++ == 0) {
+        bs->avg_cycles = cycles;
+    } else {
+        bs->avg_cycles = bs->avg_cycles - bs->avg_cycles / 16u + cycles / 16u;
+    }
+}
+
+// --- Recording --------------------------------------------------------------
+
+static void bubble_rec_flush(BubbleRecorder* rec) {
+    if(!rec->file || !rec->used) return;
+    size_t written = storage_file_write(rec->file, rec->buf, rec->used);
+    rec->bytes += (uint32_t)written;
+    rec->used = 0;
+}
+
+static void bubble_rec_append(BubbleRecorder* rec, const void* data, size_t size) {
+    if(rec->used + size > REC_BUF_SIZE) bubble_rec_flush(rec);
+    memcpy(rec->buf + rec->used, data, size);
+    rec->used += size;
+}
+
+static void bubble_rec_stop(BubbleRecorder* rec) {
+    if(rec->file) {
+        bubble_rec_flush(rec);
+        storage_file_sync(rec->file);
+        storage_file_close(rec->file);
+        storage_file_free(rec->file);
+        furi_record_close(RECORD_STORAGE);
+        FURI_LOG_I(
+            TAG, "recording: %lu frames, %lu bytes", (unsigned long)rec->frame, (unsigned long)rec->bytes);
+    }
+    rec->file = NULL;
+    rec->storage = NULL;
+}
+
+// Starts a new recording, replacing the previous one. False if the file
+// can't be created.
+static bool bubble_rec_start(BubbleRecorder* rec) {
+    bubble_rec_stop(rec);
+
+    rec->storage = furi_record_open(RECORD_STORAGE);
+    if(!rec->storage) return false;
+    storage_common_mkdir(rec->storage, APP_DATA_PATH(""));
+
+    rec->file = storage_file_alloc(rec->storage);
+    if(!rec->file ||
+       !storage_file_open(rec->file, BUBBLE_REC_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        if(rec->file) storage_file_free(rec->file);
+        rec->file = NULL;
+        furi_record_close(RECORD_STORAGE);
+        return false;
+    }
+
+    rec->used = 0;
+    rec->frame = 0;
+    rec->bytes = 0;
+
+    RecFileHeader header = {
+        .magic = REC_MAGIC,
+        .version = REC_VERSION,
+        .header_size = sizeof(RecFileHeader),
+        .screen_w = SCREEN_W,
+        .screen_h = SCREEN_H,
+        .cycles_per_us = furi_hal_cortex_instructions_per_microsecond(),
+    };
+    bubble_rec_append(rec, &header, sizeof(header));
+    return true;
+}
+
+// One frame: after the step (and the render-ahead raster, if any)
+static void bubble_rec_frame(BubbleApp* app) {
+    BubbleRecorder* rec = &app->rec;
+    if(!rec->file) return;
+
+    bool screen = rec->mode == RecModeScreen && app->render_mode == RenderModeAhead &&
+                  app->render.ready;
+
+    RecFrameHeader header = {
+        .sync = REC_FRAME_SYNC,
+        .flags = screen ? REC_FRAME_SCREEN : 0,
+        .body_count = (uint8_t)app->body_count,
+        .frame = rec->frame++,
+        .tick_ms = furi_get_tick(),
+        .step_cycles = app->perf.step_cycles,
+        .raster_cycles = app->render_mode == RenderModeAhead ? app->perf.raster_cycles : 0,
+    };
+    bubble_rec_append(rec, &header, sizeof(header));
+
+    for(size_t i = 0; i < app->body_count; i++) {
+        const PhysicsBody* b = &app->bodies[i];
+        RecBody rb = {
+            .x = (int16_t)floorf(b->x * 16.0f + 0.5f),
+            .y = (int16_t)floorf(b->y * 16.0f + 0.5f),
+            .radius = (uint8_t)(b->radius * 4.0f + 0.5f),
+            .group = (uint8_t)b->group,
+            .flags = (b->popped ? REC_BODY_POPPED : 0) |
+                     (b->pop_anim_timer > 0 ? REC_BODY_ANIMATING : 0) |
+                     (b->spawn_cooldown > 0 ? REC_BODY_COOLDOWN : 0),
+            .world = app->compare ? (uint8_t)bubble_world_of(app, i) : 0,
+        };
+        bubble_rec_append(rec, &rb, sizeof(rb));
+    }
+
+    if(screen) {
+        // Front buffer is only flipped by this thread, no lock needed to read it
+        bubble_rec_append(rec, app->render.fb[app->render.front], FB_SIZE);
+    }
+}
+
+// --- Pop feedback -----------------------------------------------------------
+//
+// Speaker clicks and vibration pulses for pops. A bus subscriber counts pops
+// and once per frame the app thread turns them into at most one request,
+// no sooner than FEEDBACK_GAP_MS after the last; pops in between merge into
+// the next request, which clicks higher and longer. Requests go to a worker
+// thread that does the blocking part, and a full queue drops the request
+// rather than wait. The Log mode plays nothing and appends what would have
+// played to feedback.txt, with both ticks, to check timing and throttling.
+
+#define FEEDBACK_GAP_MS 40 // at most 25 requests a second
+#define FEEDBACK_QUEUE_LEN 4
+#define FEEDBACK_MAX_POPS 8 // louder/longer up to this many merged pops
+
+static void bubble_feedback_log(
+    BubbleFeedback* fb,
+    const FeedbackRequest* req,
+    uint32_t ms,
+    float freq) {
+    if(!fb->log) {
+        Storage* storage = furi_record_open(RECORD_STORAGE);
+        storage_common_mkdir(storage, APP_DATA_PATH(""));
+        fb->log = storage_file_alloc(storage);
+        if(!storage_file_open(fb->log, BUBBLE_FEEDBACK_PATH, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+            storage_file_free(fb->log);
+            fb->log = NULL;
+            furi_record_close(RECORD_STORAGE);
+            return;
+        }
+    }
+
+    char line[96];
+    int len = snprintf(
+        line,
+        sizeof(line),
+        "feedback requested=%lu played=%lu pops=%u freq=%u ms=%lu\n",
+        (unsigned long)req->tick,
+        (unsigned long)furi_get_tick(),
+        (unsigned)req->pops,
+        (unsigned)freq,
+        (unsigned long)ms);
+    if(len > 0) storage_file_write(fb->log, line, (size_t)len);
+}
+
+static int32_t bubble_feedback_worker(void* context) {
+    BubbleFeedback* fb = context;
+    FeedbackRequest req;
+
+    while(furi_message_queue_get(fb->queue, &req, FuriWaitForever) == FuriStatusOk) {
+        if(!req.pops) break;
+
+        uint8_t pops = req.pops < FEEDBACK_MAX_POPS ? req.pops : FEEDBACK_MAX_POPS;
+        uint32_t ms = 6 + 2u * pops;
+        float freq = 1400.0f + 150.0f * (float)pops;
+
+        if(req.mode == FeedbackModeLog) {
+            bubble_feedback_log(fb, &req, ms, freq);
+            continue;
+        }
+
+        bool sound = req.mode == FeedbackModeSound || req.mode == FeedbackModeBoth;
+        bool vibro = req.mode == FeedbackModeVibro || req.mode == FeedbackModeBoth;
+        if(sound && !furi_hal_speaker_acquire(ms)) sound = false; // someone else has it
+        if(sound) furi_hal_speaker_start(freq, 0.4f);
+        if(vibro) furi_hal_vibro_on(true);
+        furi_delay_ms(vibro ? ms * 3 : ms); // a motor needs longer to be felt
+        if(vibro) furi_hal_vibro_on(false);
+        if(sound) {
+            furi_hal_speaker_stop();
+            furi_hal_speaker_release();
+        }
+    }
+
+    if(fb->log) {
+        storage_file_close(fb->log);
+        storage_file_free(fb->log);
+        fb->log = NULL;
+        furi_record_close(RECORD_STORAGE);
+    }
+    return 0;
+}
+
+static void bubble_feedback_on_pop(const SimEvent* event, void* context) {
+    UNUSED(event);
+    BubbleFeedback* fb = context;
+    if(fb->pending < UINT8_MAX) fb->pending++;
+}
+
+// Subscribe to pops only while a mode is on, so Off costs the bus nothing
+static void bubble_feedback_set_mode(BubbleFeedback* fb, FeedbackMode mode) {
+    if(fb->mode == FeedbackModeOff && mode != FeedbackModeOff) {
+        sim_bus_subscribe(&sim_bus, SIM_EVENT_BIT(SimEventPop), bubble_feedback_on_pop, fb);
+    } else if(fb->mode != FeedbackModeOff && mode == FeedbackModeOff) {
+        sim_bus_unsubscribe(&sim_bus, bubble_feedback_on_pop, fb);
+    }
+    fb->mode = mode;
+    fb->pending = 0;
+}
+
+// Once per frame, after the bus dispatch: send what has piled up if the
+// gap has passed. Never blocks. The gap is simulated time, so benchmarks,
+// which step without the frame delay, throttle the same as live play.
+static void bubble_feedback_flush(BubbleFeedback* fb, float dt) {
+    fb->clock_ms += (uint32_t)(dt * 1000.0f + 0.5f);
+    if(!fb->pending) return;
+    if(fb->requests && fb->clock_ms - fb->last_sent < FEEDBACK_GAP_MS) return;
+
+    FeedbackRequest req = {
+        .tick = furi_get_tick(), .pops = fb->pending, .mode = (uint8_t)fb->mode};
+    if(furi_message_queue_put(fb->queue, &req, 0) == FuriStatusOk) {
+        fb->requests++;
+        fb->merged += fb->pending - 1u;
+        fb->last_sent = fb->clock_ms;
+    } else {
+        fb->dropped++;
+    }
+    fb->pending = 0;
+}
+
+static void bubble_feedback_start(BubbleFeedback* fb) {
+    fb->queue = furi_message_queue_alloc(FEEDBACK_QUEUE_LEN, sizeof(FeedbackRequest));
+    fb->thread = furi_thread_alloc_ex("BubbleFeedback", 2 * 1024, bubble_feedback_worker, fb);
+    furi_thread_start(fb->thread);
+}
+
+static void bubble_feedback_stop(BubbleFeedback* fb) {
+    bubble_feedback_set_mode(fb, FeedbackModeOff);
+    FeedbackRequest stop = {0};
+    furi_message_queue_put(fb->queue, &stop, FuriWaitForever);
+    furi_thread_join(fb->thread);
+    furi_thread_free(fb->thread);
+    furi_message_queue_free(fb->queue);
+}
+
+// --- Frame scheduler --------------------------------------------------------
+//
+// The main loop runs one frame of cooperative tasks in SchedTaskId order.
+// Foreground tasks (input, physics, render, record) run every frame they are
+// due, whatever they cost, so nothing can starve them. Background tasks come
+// after and start only if the frame's work so far plus their budget fits in
+// SCHED_BUSY_US; otherwise they wait for a quieter frame. A task with more
+// to do returns false and picks up from task->step next frame. Every run is
+// timed against its budget for the Tasks HUD page.
+
+#define SCHED_FRAME_MS 30
+#define SCHED_BUSY_US 20000    // the rest of the frame is left to the GUI thread
+#define SCHED_WINDOW_FRAMES 33 // ~1 s per HUD figure
+#define CONFIG_SAVE_FRAMES 15  // save group edits once they settle (~0.5 s)
+
+typedef bool (*SchedTaskFn)(BubbleApp* app, SchedTask* task, bool* running);
+
+typedef struct {
+    const char* name;
+    uint16_t period; // frames between runs, 0 = only when woken
+    uint16_t budget_us;
+    bool foreground;
+} SchedTaskInfo;
+
+static const SchedTaskInfo sched_task_info[SchedTaskCountEnum] = {
+    [SchedTaskInput] = {"input", 1, 1000, true},
+    [SchedTaskPhysics] = {"phys", 1, 8000, true},
+    [SchedTaskRender] = {"render", 1, 4000, true},
+    [SchedTaskRecord] = {"rec", 1, 1000, true},
+    [SchedTaskFlush] = {"sd", 0, 10000, false},
+    [SchedTaskConfig] = {"config", 0, 10000, false},
+    [SchedTaskStats] = {"stats", STATS_LOG_FRAMES, 1000, false},
+    [SchedTaskTune] = {"tune", 0, 8000, false},
+};
+
+static void sched_init(Scheduler* sched) {
+    memset(sched, 0, sizeof(*sched));
+    for(size_t id = 0; id < SchedTaskCountEnum; id++) {
+        uint16_t period = sched_task_info[id].period;
+        sched->tasks[id].next = period ? period - 1u : 0; // at the end of the first period
+    }
+}
+
+static void sched_wake(Scheduler* sched, SchedTaskId id) {
+    sched->tasks[id].pending = true;
+}
+
+static void sched_run_frame(
+    Scheduler* sched,
+    const SchedTaskFn* fns,
+    BubbleApp* app,
+    bool* running
+) {
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+    uint32_t frame_start = perf_cycles();
+
+    for(size_t id = 0; id < SchedTaskCountEnum; id++) {
+        const SchedTaskInfo* info = &sched_task_info[id];
+        SchedTask* task = &sched->tasks[id];
+        if(info->period && sched->frame >= task->next) task->pending = true;
+        if(!task->pending) continue;
+
+        uint32_t start = perf_cycles();
+        if(!info->foreground && (start - frame_start) / cpu + info->budget_us > SCHED_BUSY_US) {
+            task->deferred++;
+            continue;
+        }
+
+        bool done = fns[id](app, task, running);
+        uint32_t cycles = perf_cycles() - start;
+        task->runs++;
+        if(cycles / cpu > info->budget_us) task->overruns++;
+        task->window_cycles += cycles;
+        if(cycles > task->window_max) task->window_max = cycles;
+        if(done) {
+            task->pending = false;
+            task->next = sched->frame + info->period;
+        }
+    }
+
+    sched->frame_cycles = perf_cycles() - frame_start;
+    if(++sched->frame % SCHED_WINDOW_FRAMES) return;
+    for(size_t id = 0; id < SchedTaskCountEnum; id++) {
+        SchedTask* task = &sched->tasks[id];
+        task->avg_us = task->window_cycles / cpu / SCHED_WINDOW_FRAMES;
+        task->max_us = task->window_max / cpu;
+        task->window_cycles = 0;
+        task->window_max = 0;
+    }
+}
+
+// --- Broadphase auto-tune ---------------------------------------------------
+//
+// The fastest broadphase depends on the group radii and counts. With Broad
+// on Auto, the tune task measures every setting off-screen on the current
+// config: the same scene of TUNE_STEPS Step frames per candidate, bodies
+// spread over the screen, no pops and a wrap instead of respawns so the
+// count stays put. It runs in TUNE_SLICE_US slices of spare frame time,
+// drops a candidate once it has cost more than the best finished one and
+// stops at TUNE_CAP_MS of stepping. The pick is stored in BUBBLE_TUNE_PATH
+// under a hash of the config, so a config seen before is not measured again.
+
+#define TUNE_STEPS 200
+#define TUNE_SLICE_US 6000
+#define TUNE_CAP_MS 1500
+#define TUNE_SEED 0x54554E45u // "TUNE"
+#define TUNE_CACHE_ENTRIES 16 // most recent first
+
+typedef struct {
+    uint32_t hash;
+    uint8_t setting; // index into broadphase_settings
+    uint8_t reserved[3];
+} TuneCacheEntry;
+
+static void bubble_apply_broadphase(BubbleApp* app) {
+    const BroadphaseSetting* setting = &broadphase_settings[app->broad_setting];
+    app->broad.kind = setting->kind;
+    app->broad.cell_shift = setting->cell_shift;
+}
+
+// FNV-1a over what the measurement depends on; never 0
+static uint32_t tune_config_hash(const BubbleApp* app) {
+    uint32_t hash = 2166136261u;
+    float v[2 + GROUP_COUNT * 4] = {
+        app->bounds.max_x - app->bounds.min_x, app->bounds.max_y - app->bounds.min_y};
+    for(int g = 0; g < GROUP_COUNT; g++) {
+        v[2 + g * 4] = (float)(app->groups[g].count > 0 ? app->groups[g].count : 0);
+        v[3 + g * 4] = app->groups[g].radius;
+        v[4 + g * 4] = app->groups[g].rise_speed;
+        v[5 + g * 4] = app->groups[g].restitution;
+    }
+    const uint8_t* bytes = (const uint8_t*)v;
+    for(size_t i = 0; i < sizeof(v); i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash ? hash : 1u;
+}
+
+static size_t tune_cache_load(TuneCacheEntry* entries) {
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    if(!storage) return 0;
+
+    File* file = storage_file_alloc(storage);
+    if(!file) {
+        furi_record_close(RECORD_STORAGE);
+        return 0;
+    }
+
+    size_t rd = 0;
+    if(storage_file_open(file, BUBBLE_TUNE_PATH, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        rd = storage_file_read(file, entries, sizeof(TuneCacheEntry) * TUNE_CACHE_ENTRIES);
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+    return rd / sizeof(TuneCacheEntry);
+}
+
+static bool tune_cache_lookup(uint32_t hash, uint8_t* setting) {
+    TuneCacheEntry entries[TUNE_CACHE_ENTRIES];
+    size_t count = tune_cache_load(entries);
+    for(size_t i = 0; i < count; i++) {
+        if(entries[i].hash != hash || entries[i].setting >= BROADPHASE_SETTING_COUNT) continue;
+        *setting = entries[i].setting;
+        return true;
+    }
+    return false;
+}
+
+// Put hash first, dropping its old entry or else the oldest one
+static void tune_cache_store(uint32_t hash, uint8_t setting) {
+    TuneCacheEntry entries[TUNE_CACHE_ENTRIES];
+    size_t count = tune_cache_load(entries);
+    size_t at = 0;
+    while(at < count && entries[at].hash != hash) at++;
+    if(at == count && count == TUNE_CACHE_ENTRIES) at--;
+    memmove(&entries[1], &entries[0], at * sizeof(TuneCacheEntry));
+    if(at == count) count++;
+    memset(&entries[0], 0, sizeof(TuneCacheEntry));
+    entries[0].hash = hash;
+    entries[0].setting = setting;
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    if(!storage) return;
+    storage_common_mkdir(storage, APP_DATA_PATH(""));
+
+    File* file = storage_file_alloc(storage);
+    if(!file) {
+        furi_record_close(RECORD_STORAGE);
+        return;
+    }
+
+    if(storage_file_open(file, BUBBLE_TUNE_PATH, FSAM_WRITE, FSOM_CREATE_ALWAYS)) {
+        storage_file_write(file, entries, count * sizeof(TuneCacheEntry));
+        storage_file_sync(file);
+    }
+
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
+}
+
+// The same scene for every candidate: world A's groups spread over the
+// screen, out of cooldown and unable to pop
+static void tune_begin_candidate(TuneRun* run, const BubbleApp* app) {
+    const WorldBounds* bounds = &app->bounds;
+    rng_init(&run->rng, TUNE_SEED);
+    run->count = 0;
+    for(int g = 0; g < GROUP_COUNT; g++) {
+        const BubbleGroupConfig* cfg = &app->groups[g];
+        for(int i = 0; i < cfg->count && run->count < MAX_BODIES; i++) {
+            PhysicsBody* b = &run->bodies[run->count++];
+            bubble_init_body(b, cfg, g, bounds, &run->rng);
+            b->y = bounds->min_y + rng_next_float01(&run->rng) * (bounds->max_y - bounds->min_y);
+            b->spawn_cooldown = 0;
+            b->pop_chance = 0.0f;
+        }
+    }
+
+    memset(&run->bp, 0, sizeof(run->bp));
+    run->bp.kind = broadphase_settings[run->candidate].kind;
+    run->bp.cell_shift = broadphase_settings[run->candidate].cell_shift;
+    run->steps = 0;
+}
+
+// Step until the slice is used up; true once the measurement is over
+static bool tune_slice(TuneRun* run, const BubbleApp* app, uint32_t slice_cycles) {
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+    uint32_t start = perf_cycles();
+    uint8_t bus_mask = sim_bus.mask; // the scratch scene has no listeners
+    sim_bus.mask = 0;
+
+    bool over = false;
+    while(!over && perf_cycles() - start < slice_cycles) {
+        if(run->steps == 0) tune_begin_candidate(run, app);
+
+        uint32_t t = perf_cycles();
+        physics_step_broadphase(
+            &run->bp,
+            run->bodies,
+            run->count,
+            SCHED_FRAME_MS / 1000.0f,
+            app->gravity_y,
+            &app->bounds,
+            &run->rng,
+            NULL);
+        uint32_t cycles = perf_cycles() - t;
+
+        for(size_t i = 0; i < run->count; i++) {
+            PhysicsBody* b = &run->bodies[i];
+            if(b->y + b->radius < app->bounds.min_y) b->y = app->bounds.max_y + b->radius;
+        }
+
+        size_t c = run->candidate;
+        run->cycles[c] += cycles;
+        run->spent += cycles;
+        run->steps++;
+
+        uint32_t best = UINT32_MAX;
+        for(size_t k = 0; k < c; k++) {
+            if(run->done[k] == TUNE_STEPS && run->cycles[k] < best) best = run->cycles[k];
+        }
+        if(run->steps == TUNE_STEPS || run->cycles[c] > best) {
+            run->done[c] = run->steps;
+            run->steps = 0;
+            over = ++run->candidate == BROADPHASE_SETTING_COUNT;
+        }
+        if(run->spent / cpu / 1000 >= TUNE_CAP_MS) over = true;
+    }
+
+    sim_bus.mask = bus_mask;
+    return over;
+}
+
+// Fastest candidate that ran every step, false if none did
+static bool tune_pick(const TuneRun* run, uint8_t* pick) {
+    bool found = false;
+    for(size_t k = 0; k < BROADPHASE_SETTING_COUNT; k++) {
+        if(run->done[k] != TUNE_STEPS) continue;
+        if(!found || run->cycles[k] < run->cycles[*pick]) *pick = (uint8_t)k;
+        found = true;
+    }
+    return found;
+}
+
+static void bubble_tune_apply(BubbleApp* app, uint8_t pick) {
+    app->broad_setting = pick;
+    bubble_apply_broadphase(app);
+}
+
+static void bubble_tune_cancel(BubbleApp* app) {
+    free(app->tuner.run);
+    app->tuner.run = NULL;
+}
+
+// One slice of the tune task: settle, cache lookup, measure, store
+static bool bubble_tune_step(BubbleApp* app) {
+    BubbleTuner* tuner = &app->tuner;
+    if(!app->broad_auto || app->bench_running) {
+        bubble_tune_cancel(app);
+        return true;
+    }
+    if(app->sched.frame - app->config_changed < CONFIG_SAVE_FRAMES) return false;
+
+    uint32_t hash = tune_config_hash(app);
+    if(tuner->run && tuner->run->hash != hash) bubble_tune_cancel(app); // edited meanwhile
+    if(!tuner->run) {
+        if(hash == tuner->hash) return true;
+
+        uint8_t pick = 0;
+        if(tune_cache_lookup(hash, &pick)) {
+            tuner->hash = hash;
+            tuner->pick = pick;
+            tuner->cached = true;
+            tuner->capped = false;
+            tuner->pick_us = 0;
+            bubble_tune_apply(app, pick);
+            return true;
+        }
+
+        tuner->run = malloc(sizeof(TuneRun));
+        if(!tuner->run) return true;
+        memset(tuner->run, 0, sizeof(TuneRun));
+        tuner->run->hash = hash;
+        return false;
+    }
+
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+    TuneRun* run = tuner->run;
+    if(!tune_slice(run, app, TUNE_SLICE_US * cpu)) return false;
+
+    uint8_t pick = 0;
+    if(tune_pick(run, &pick)) {
+        tuner->hash = hash;
+        tuner->pick = pick;
+        tuner->cached = false;
+        tuner->capped = run->candidate < BROADPHASE_SETTING_COUNT;
+        tuner->pick_us = run->cycles[pick] / cpu / TUNE_STEPS;
+        tuner->measured++;
+        bubble_tune_apply(app, pick);
+        tune_cache_store(hash, pick);
+        FURI_LOG_I(
+            TAG,
+            "tune %08lx: %s %luus/step%s",
+            (unsigned long)hash,
+            broadphase_settings[pick].name,
+            (unsigned long)tuner->pick_us,
+            tuner->capped ? " (capped)" : "");
+    }
+    bubble_tune_cancel(app);
+    return true;
+}
+
+// --- Framebuffer ------------------------------------------------------------
+//
+// Same layout as the display buffer behind the canvas: 8 pages of 128 bytes,
+// each byte a vertical run of 8 pixels, LSB on top.
+
+static inline void fb_set_pixel(uint8_t* fb, int x, int y) {
+    if((unsigned)x >= SCREEN_W || (unsigned)y >= SCREEN_H) return;
+    fb[(y >> 3) * SCREEN_W + x] |= (uint8_t)(1u << (y & 7));
+}
+
+static inline void fb_circle_section(uint8_t* fb, int x, int y, int x0, int y0) {
+    fb_set_pixel(fb, x0 + x, y0 - y);
+    fb_set_pixel(fb, x0 + y, y0 - x);
+    fb_set_pixel(fb, x0 - x, y0 - y);
+    fb_set_pixel(fb, x0 - y, y0 - x);
+    fb_set_pixel(fb, x0 + x, y0 + y);
+    fb_set_pixel(fb, x0 + y, y0 + x);
+    fb_set_pixel(fb, x0 - x, y0 + y);
+    fb_set_pixel(fb, x0 - y, y0 + x);
+}
+
+// Midpoint circle, step for step the one canvas_draw_circle uses
+static void fb_draw_circle(uint8_t* fb, int x0, int y0, int r) {
+    if(x0 + r < 0 || x0 - r >= SCREEN_W || y0 + r < 0 || y0 - r >= SCREEN_H) return;
+
+    int f = 1 - r;
+    int ddf_x = 1;
+    int ddf_y = -2 * r;
+    int x = 0;
+    int y = r;
+
+    fb_circle_section(fb, x, y, x0, y0);
+    while(x < y) {
+        if(f >= 0) {
+            y--;
+            ddf_y += 2;
+            f += ddf_y;
+        }
+        x++;
+        ddf_x += 2;
+        f += ddf_x;
+        fb_circle_section(fb, x, y, x0, y0);
+    }
+}
+
+// Filled discs from span tables. The display packs 8 rows per byte, so a
+// disc is filled column by column: span_half gives each column's half
+// height for every radius, and a column costs one masked OR per 8 rows it
+// crosses. Fills use a 4x4 ordered (Bayer) dither; within a page its
+// pattern is the same byte for every column with the same x & 3.
+
+#define SPAN_MAX_RADIUS 32 // BUBBLE_MAX_RADIUS
+#define SHADE_LEVEL 4      // of 16 pixels set in a fill
+
+// Column dx (0..r) of radius r at span_half[r * (r + 1) / 2 + dx]; built
+// once at startup by fb_span_init()
+static uint8_t span_half[(SPAN_MAX_RADIUS + 1) * (SPAN_MAX_RADIUS + 2) / 2];
+static uint8_t shade_column[4]; // dither byte per x & 3
+
+static const uint8_t bayer4[4][4] = {
+    {0, 8, 2, 10},
+    {12, 4, 14, 6},
+    {3, 11, 1, 9},
+    {15, 7, 13, 5},
+};
+
+static void fb_span_init(void) {
+    for(int r = 0; r <= SPAN_MAX_RADIUS; r++) {
+        uint8_t* half = &span_half[r * (r + 1) / 2];
+        int h = r;
+        for(int dx = 0; dx <= r; dx++) {
+            while(h > 0 && dx * dx + h * h > r * r + r) h--; // inside r + 1/2
+            half[dx] = (uint8_t)h;
+        }
+    }
+
+    for(int x = 0; x < 4; x++) {
+        uint8_t column = 0;
+        for(int y = 0; y < 8; y++) {
+            if(bayer4[y & 3][x] < SHADE_LEVEL) column |= (uint8_t)(1u << y);
+        }
+        shade_column[x] = column;
+    }
+}
+
+// Rows y0..y1 (on screen) of column x: set through the pattern, or clear
+static inline void fb_vspan(uint8_t* fb, int x, int y0, int y1, uint8_t pattern, bool clear) {
+    int first = y0 >> 3;
+    int last = y1 >> 3;
+    uint8_t* p = &fb[first * SCREEN_W + x];
+    for(int page = first; page <= last; page++, p += SCREEN_W) {
+        uint8_t mask = 0xFF;
+        if(page == first) mask &= (uint8_t)(0xFF << (y0 & 7));
+        if(page == last) mask &= (uint8_t)(0xFF >> (7 - (y1 & 7)));
+        if(clear) {
+            *p &= (uint8_t)~mask;
+        } else {
+            *p |= mask & pattern;
+        }
+    }
+}
+
+// Dithered disc, or a disc cleared to white
+static void fb_fill_disc(uint8_t* fb, int x0, int y0, int r, bool clear) {
+    if(r < 0) return;
+    if(r > SPAN_MAX_RADIUS) r = SPAN_MAX_RADIUS;
+    if(x0 + r < 0 || x0 - r >= SCREEN_W || y0 + r < 0 || y0 - r >= SCREEN_H) return;
+
+    const uint8_t* half = &span_half[r * (r + 1) / 2];
+    int xa = x0 - r < 0 ? 0 : x0 - r;
+    int xb = x0 + r >= SCREEN_W ? SCREEN_W - 1 : x0 + r;
+    for(int x = xa; x <= xb; x++) {
+        int h = half[x < x0 ? x0 - x : x - x0];
+        int ya = y0 - h < 0 ? 0 : y0 - h;
+        int yb = y0 + h >= SCREEN_H ? SCREEN_H - 1 : y0 + h;
+        if(ya > yb) continue;
+        fb_vspan(fb, x, ya, yb, shade_column[x & 3], clear);
+    }
+}
+
+// --- Fizz particles ---------------------------------------------------------
+//
+// Thousands of 1 px bubbles that never collide, kept apart from PhysicsBody
+// and the steppers. Each particle is one Packed16 word, x and y in lanes
+// scaled so that a lane's 65536 steps span the screen (512 per px across,
+// 1024 per px down): integration is the packed SADD16 kernel, one
+// instruction per particle, and the lanes' wrap-around is the respawn.
+// Sideways wobble is looked up per particle from one shared table at draw
+// time; drawing is one OR per particle straight into the framebuffer.
+
+#define FIZZ_X_SHIFT 9  // 65536 >> 9 = 128 px
+#define FIZZ_Y_SHIFT 10 // 65536 >> 10 = 64 px
+#define FIZZ_WOBBLE_STEPS 64
+#define FIZZ_SEED 0xF122u
+
+_Static_assert(SCREEN_W == 65536 >> FIZZ_X_SHIFT, "fizz x lane must span the screen");
+_Static_assert(SCREEN_H == 65536 >> FIZZ_Y_SHIFT, "fizz y lane must span the screen");
+
+static int16_t fizz_wobble[FIZZ_WOBBLE_STEPS]; // x offset, lane units
+
+// Arrays for FIZZ_MAX on first use, then count particles scattered over the
+// screen rising at 0.25-1 px per frame. False if memory ran out.
+static bool fizz_set_count(FizzLayer* fz, uint16_t count) {
+    if(count && !fz->pos) {
+        fz->pos = malloc(FIZZ_MAX * sizeof(Packed16));
+        fz->vel = malloc(FIZZ_MAX * sizeof(Packed16));
+        fz->phase = malloc(FIZZ_MAX);
+        if(!fz->pos || !fz->vel || !fz->phase) {
+            free(fz->pos);
+            free(fz->vel);
+            free(fz->phase);
+            fz->pos = NULL;
+            fz->vel = NULL;
+            fz->phase = NULL;
+            fz->count = 0;
+            return false;
+        }
+        for(size_t k = 0; k < FIZZ_WOBBLE_STEPS; k++) {
+            float a = (float)k * (6.2831853f / FIZZ_WOBBLE_STEPS);
+            fizz_wobble[k] = (int16_t)(sinf(a) * 1.5f * (1 << FIZZ_X_SHIFT));
+        }
+    }
+
+    rng_init(&fz->rng, FIZZ_SEED);
+    for(uint16_t i = 0; i < count; i++) {
+        uint32_t r = rng_next(&fz->rng);
+        fz->pos[i] = r; // anywhere on screen
+        int16_t vx = (int16_t)((int32_t)(rng_next(&fz->rng) & 63) - 32);
+        int16_t vy = (int16_t)(-256 - (int32_t)(rng_next(&fz->rng) & 767));
+        fz->vel[i] = pk_pack(vx, vy);
+        fz->phase[i] = (uint8_t)rng_next(&fz->rng);
+    }
+    fz->count = count;
+    fz->tick = 0;
+    return true;
+}
+
+static void fizz_free(FizzLayer* fz) {
+    fz->count = 0;
+    free(fz->pos);
+    free(fz->vel);
+    free(fz->phase);
+    fz->pos = NULL;
+    fz->vel = NULL;
+    fz->phase = NULL;
+}
+
+static void fizz_update(FizzLayer* fz) {
+    if(!fz->count) return;
+    uint32_t start = perf_cycles();
+    pk_integrate_dsp(fz->pos, fz->vel, fz->count);
+    fz->tick++;
+    fz->update_cycles = perf_cycles() - start;
+}
+
+static void fizz_draw(FizzLayer* fz, uint8_t* fb) {
+    if(!fz->count) return;
+    uint32_t start = perf_cycles();
+    uint16_t t = fz->tick >> 1;
+    for(uint16_t i = 0; i < fz->count; i++) {
+        Packed16 p = fz->pos[i];
+        uint16_t wx = (uint16_t)(p + (uint16_t)fizz_wobble[(fz->phase[i] + t) & (FIZZ_WOBBLE_STEPS - 1)]);
+        unsigned x = wx >> FIZZ_X_SHIFT;
+        unsigned y = (p >> 16) >> FIZZ_Y_SHIFT;
+        fb[(y >> 3) * SCREEN_W + x] |= (uint8_t)(1u << (y & 7));
+    }
+    fz->draw_cycles = perf_cycles() - start;
+}
+
+// Particles per millisecond for the given cycles, 0 when nothing ran
+static uint32_t fizz_per_ms(const FizzLayer* fz, uint32_t cycles) {
+    if(!fz->count || !cycles) return 0;
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+    return (uint32_t)((uint64_t)fz->count * cpu * 1000u / cycles);
+}
+
+// --- Water surface ----------------------------------------------------------
+//
+// A ripple line a few px below the top edge, kept apart from the simulation
+// like the fizz: it reads the bodies and never moves them. Each screen
+// column is one int16 height and velocity in Q10 px, stepped as a damped 1D
+// wave equation by pk_wave_dsp(), two columns per word: halving adds for
+// the neighbours' pull, saturating adds and subtracts, lane-wise shifts for
+// the damping and the spring, no floats and no per-column branches. A
+// bubble whose centre rises through the line kicks the columns under it,
+// harder for bigger and faster bubbles; the kick takes the body's radius
+// and speed as Q7 and works in integers from there. Drawing is one vertical span per column, a polyline with its
+// segments meeting halfway between columns.
+
+#define WATER_Y 6             // rest line, px from the top
+#define WATER_SHIFT 10        // Q10: 1024 per px, rounding stays under 1/4 px
+#define WATER_DAMP_SHIFT 5    // lose 1/32 of the velocity per frame
+#define WATER_SPRING_SHIFT 7  // pull back to the rest line, drains what kicks add
+#define WATER_V_MAX (2 << WATER_SHIFT) // fastest a kick sends a column up
+#define WATER_KICK_SPREAD 2            // columns past the radius that still move
+#define WATER_KICK_SPEED_MAX (60 * PK_ONE) // Q7 px/s; faster bubbles kick no harder
+
+static void water_reset(WaterSurface* ws) {
+    memset(&ws->h, 0, sizeof(ws->h));
+    memset(&ws->v, 0, sizeof(ws->v));
+    ws->below = 0;
+    ws->splashes = 0;
+}
+
+// Push the columns under a body breaking through upwards: a tent over
+// radius + WATER_KICK_SPREAD columns either side, peak by size and speed
+// (Q10 peak = 0.625 * radius + speed / 16, radius and speed in Q7)
+static void water_kick(WaterSurface* ws, const PhysicsBody* b) {
+    int32_t radius = pk_from_float(b->radius);
+    int32_t speed = -(int32_t)pk_from_float(b->vy);
+    speed = speed < 0 ? 0 : (speed > WATER_KICK_SPEED_MAX ? WATER_KICK_SPEED_MAX : speed);
+    int32_t peak = ((radius * 5) >> 3) + (speed >> 4);
+    int reach = (radius >> PK_SHIFT) + WATER_KICK_SPREAD;
+    int x0 = pk_from_float(b->x) >> PK_SHIFT;
+    for(int dx = -reach; dx <= reach; dx++) {
+        int x = x0 + dx;
+        if(x < 0 || x >= SCREEN_W) continue;
+        int32_t kick = peak * (reach + 1 - (dx < 0 ? -dx : dx)) / (reach + 1);
+        int32_t v = ws->v.col[x] - kick; // up is negative
+        ws->v.col[x] = (int16_t)(v < -WATER_V_MAX ? -WATER_V_MAX : v);
+    }
+    ws->splashes++;
+}
+
+// One frame: kick for bodies that crossed the line, then step the wave
+static void water_update(WaterSurface* ws, const PhysicsBody* bodies, size_t count) {
+    if(!ws->on) return;
+    uint32_t start = perf_cycles();
+
+    uint64_t below = 0;
+    uint64_t alive = 0;
+    for(size_t i = 0; i < count; i++) {
+        const PhysicsBody* b = &bodies[i];
+        if(b->popped) continue;
+        alive |= 1ull << i;
+        if(b->y >= (float)WATER_Y) below |= 1ull << i;
+    }
+    uint64_t crossed = ws->below & ~below & alive;
+    ws->below = below;
+    while(crossed) {
+        int i = __builtin_ctzll(crossed);
+        crossed &= crossed - 1;
+        water_kick(ws, &bodies[i]);
+    }
+
+    // Velocity then height, two columns per word; the end columns mirror
+    // themselves, so the edges reflect
+    pk_wave_dsp(ws->h.pair, ws->v.pair, SCREEN_W / 2, WATER_DAMP_SHIFT, WATER_SPRING_SHIFT);
+    ws->update_cycles = perf_cycles() - start;
+}
+
+static inline int water_row(const WaterSurface* ws, int x) {
+    int y = WATER_Y + ((ws->h.col[x] + (1 << (WATER_SHIFT - 1))) >> WATER_SHIFT);
+    return y < 0 ? 0 : (y >= SCREEN_H ? SCREEN_H - 1 : y);
+}
+
+static void water_draw(WaterSurface* ws, uint8_t* fb) {
+    if(!ws->on) return;
+    uint32_t start = perf_cycles();
+    int prev = water_row(ws, 0);
+    int here = prev;
+    for(int x = 0; x < SCREEN_W; x++) {
+        int next = x + 1 < SCREEN_W ? water_row(ws, x + 1) : here;
+        // From halfway to the left neighbour to halfway to the right one
+        int a = (prev + here) >> 1;
+        int b = (here + next) >> 1;
+        int lo = here < a ? here : a;
+        int hi = here > a ? here : a;
+        lo = b < lo ? b : lo;
+        hi = b > hi ? b : hi;
+        fb_vspan(fb, x, lo, hi, 0xFF, false);
+        prev = here;
+        here = next;
+    }
+    ws->draw_cycles = perf_cycles() - start;
+}
+
+// Millionths of a SCHED_FRAME_MS frame spent on the water, for the given
+// update and draw cycles
+static uint32_t water_budget_ppm(uint32_t cycles) {
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+    return (uint32_t)((uint64_t)cycles * 1000u / cpu / SCHED_FRAME_MS);
+}
+
+// --- Drawing ----------------------------------------------------------------
+
+// Bodies draw either through the canvas (GUI thread) or straight into one of
+// the render-ahead framebuffers (app thread); same shapes, same pixels.
+typedef struct {
+    Canvas* canvas;
+    uint8_t* fb;    // non-NULL => rasterize here instead of the canvas
+    uint8_t* spans; // fills: fb, or the canvas's own buffer; NULL => outlines
+    RenderStyle style;
+} DrawTarget;
+
+static void target_draw_circle(const DrawTarget* target, int x, int y, int r) {
+    if(target->fb) {
+        fb_draw_circle(target->fb, x, y, r);
+    } else {
+        canvas_draw_circle(target->canvas, x, y, r);
+    }
+}
+
+static void target_draw_dot(const DrawTarget* target, int x, int y) {
+    if(target->fb) {
+        fb_set_pixel(target->fb, x, y);
+    } else if((unsigned)x < SCREEN_W && (unsigned)y < SCREEN_H) {
+        canvas_draw_dot(target->canvas, x, y);
+    }
+}
+
+// Midpoint circle keeping every `every`-th step of each octant
+static void target_draw_circle_dotted(const DrawTarget* target, int x0, int y0, int r, int every) {
+    int f = 1 - r;
+    int ddf_x = 1;
+    int ddf_y = -2 * r;
+    int x = 0;
+    int y = r;
+
+    while(x <= y) {
+        if(x % every == 0) {
+            target_draw_dot(target, x0 + x, y0 - y);
+            target_draw_dot(target, x0 + y, y0 - x);
+            target_draw_dot(target, x0 - x, y0 - y);
+            target_draw_dot(target, x0 - y, y0 - x);
+            target_draw_dot(target, x0 + x, y0 + y);
+            target_draw_dot(target, x0 + y, y0 + x);
+            target_draw_dot(target, x0 - x, y0 + y);
+            target_draw_dot(target, x0 - y, y0 + x);
+        }
+        if(f >= 0) {
+            y--;
+            ddf_y += 2;
+            f += ddf_y;
+        }
+        x++;
+        ddf_x += 2;
+        f += ddf_x;
+    }
+}
+
+static void bubble_draw_body(
+    const DrawTarget* target,
+    const PhysicsBody* b,
+    bool selected,
+    int depth);
+
+static void bubble_draw_pop(const DrawTarget* target, const PhysicsBody* b) {
+    int x = (int)(b->x + 0.5f);
+    int y = (int)(b->y + 0.5f);
+    int base_r = (int)(b->radius + 0.5f);
+    if(base_r < 1) base_r = 1;
+
+    int t = b->pop_anim_timer;
+    if(t <= 0) return;
+
+    // POP_ANIM_FRAMES .. 1
+    float alpha = (float)t / (float)POP_ANIM_FRAMES; // 1 -> 0
+    int r_outer = base_r + (int)((1.0f - alpha) * 4.0f + 0.5f);
+
+    // Outer ring
+    target_draw_circle(target, x, y, r_outer);
+
+    // Inner ring early in the animation to look like fragments
+    if(t > POP_ANIM_FRAMES / 2 && r_outer > 2) {
+        target_draw_circle(target, x, y, r_outer - 2);
+    }
+}
+
+// Back layers: a plain ring one layer back, dotted sparser with each one
+// after that; no rim, highlight or fill
+static void bubble_draw_far(const DrawTarget* target, int x, int y, int r, int depth) {
+    if(depth == 1) {
+        target_draw_circle(target, x, y, r);
+    } else {
+        target_draw_circle_dotted(target, x, y, r, depth);
+    }
+}
+
+static void bubble_draw_body(
+    const DrawTarget* target,
+    const PhysicsBody* b,
+    bool selected,
+    int depth) {
+    int x = (int)(b->x + 0.5f);
+    int y = (int)(b->y + 0.5f);
+    int r = (int)(b->radius + 0.5f);
+    if(r < 1) r = 1;
+
+    if(x + r < 0 || x - r >= SCREEN_W) return;
+    if(y + r < 0 || y - r >= SCREEN_H) return;
+
+    if(depth > 0) {
+        bubble_draw_far(target, x, y, r, depth);
+        if(selected) target_draw_circle(target, x, y, r + 1);
+        return;
+    }
+
+    // Shaded: dithered body with a clear highlight, then the outline
+    if(target->style == RenderStyleShaded && target->spans) {
+        fb_fill_disc(target->spans, x, y, r - 1, false);
+        if(r >= 3) fb_fill_disc(target->spans, x - r / 3, y - r / 3, r / 3, true);
+        target_draw_circle(target, x, y, r);
+        if(selected) target_draw_circle(target, x, y, r + 1);
+        return;
+    }
+
+    // 1) Main bubble outline
+    target_draw_circle(target, x, y, r);
+
+    // 2) Inner rim to suggest bubble thickness
+    if(r > 3) {
+        target_draw_circle(target, x, y, r - 2);
+    }
+
+    // 3) Highlight near top-left to sell "glossy bubble"
+    if(r >= 3) {
+        int hx = x - r / 3;
+        int hy = y - r / 3;
+        // Small highlight dot (approximate with a tiny circle)
+        target_draw_circle(target, hx, hy, 1);
+    }
+
+    // 4) Selected group: subtle extra ring for visibility
+    if(selected) {
+        target_draw_circle(target, x, y, r + 1);
+    }
+}
+
+static void bubble_draw_bodies(const BubbleApp* app, const DrawTarget* target) {
+    bool layered = bubble_layered(app);
+    for(size_t i = 0; i < app->body_count; i++) {
+        const PhysicsBody* b = &app->bodies[i];
+
+        // If we're popped but waiting for respawn, don't draw bubble body
+        if(b->popped && b->pop_anim_timer <= 0) {
+            continue;
+        }
+
+        bool selected = (app->hud_page != HudPageHidden) && (b->group == app->selected_group) &&
+                        (!app->compare || bubble_world_of(app, i) == app->edit_world);
+
+        if(b->popped && b->pop_anim_timer > 0) {
+            bubble_draw_pop(target, b);
+        } else {
+            bubble_draw_body(target, b, selected, layered ? bubble_layer_of(app, i) : 0);
+        }
+    }
+}
+
+// App thread, right after the physics step: rasterize into the back buffer,
+// then flip it to the front under the lock the draw callback blits with.
+static void bubble_render_ahead(BubbleApp* app) {
+    RenderAhead* ra = &app->render;
+    uint32_t start = perf_cycles();
+
+    uint8_t back = ra->front ^ 1;
+    memset(ra->fb[back], 0, FB_SIZE);
+    fizz_draw(&app->fizz, ra->fb[back]);
+    water_draw(&app->water, ra->fb[back]);
+    DrawTarget target = {.fb = ra->fb[back], .spans = ra->fb[back], .style = app->render_style};
+    for(int pass = 0; pass < (app->render_overdraw ? app->render_overdraw : 1); pass++) {
+        bubble_draw_bodies(app, &target);
+    }
+
+    furi_mutex_acquire(ra->mutex, FuriWaitForever);
+    ra->front = back;
+    ra->ready = true;
+    furi_mutex_release(ra->mutex);
+
+    app->perf.raster_cycles = perf_cycles() - start;
+}
+
+// Draw callback side: copy the finished frame into the canvas. Returns false
+// if there is nothing to blit and the bodies must be drawn directly.
+static bool bubble_blit_ahead(BubbleApp* app, Canvas* canvas) {
+    RenderAhead* ra = &app->render;
+    if(app->render_mode != RenderModeAhead || !ra->ready) return false;
+    if(canvas_get_buffer_size(canvas) != FB_SIZE) return false;
+
+    furi_mutex_acquire(ra->mutex, FuriWaitForever);
+    memcpy(canvas_get_buffer(canvas), ra->fb[ra->front], FB_SIZE);
+    furi_mutex_release(ra->mutex);
+    return true;
+}
+
+// Perf page: last step cost and physics cost per simulated second
+static void bubble_draw_perf(Canvas* canvas, const BubbleApp* app) {
+    canvas_set_font(canvas, FontSecondary);
+    char buf[48];
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+
+    physics_backends[app->physics_mode].describe(app, buf, sizeof(buf));
+    canvas_draw_str(canvas, 0, SCREEN_H - 10, buf);
+
+    snprintf(
+        buf,
+        sizeof(buf),
+        "draw %luus rast %luus",
+        (unsigned long)(app->perf.draw_cycles / cpu),
+        (unsigned long)(app->render_mode == RenderModeAhead ? app->perf.raster_cycles / cpu : 0));
+    canvas_draw_str(canvas, 0, SCREEN_H - 19, buf);
+
+    if(app->fizz.count) {
+        snprintf(
+            buf,
+            sizeof(buf),
+            "fizz %u u%lu d%lu/ms",
+            (unsigned)app->fizz.count,
+            (unsigned long)fizz_per_ms(&app->fizz, app->fizz.update_cycles),
+            (unsigned long)fizz_per_ms(&app->fizz, app->fizz.draw_cycles));
+        canvas_draw_str(canvas, 0, SCREEN_H - 37, buf);
+    }
+
+    if(bubble_layered(app)) {
+        // Per-layer step time, front first
+        size_t n = (size_t)snprintf(buf, sizeof(buf), "layers");
+        for(int l = 0; l < app->layer_count && n < sizeof(buf); l++) {
+            n += (size_t)snprintf(
+                buf + n,
+                sizeof(buf) - n,
+                "%c%lu",
+                l ? '/' : ' ',
+                (unsigned long)(app->layers[l].step_cycles / cpu));
+        }
+        if(n < sizeof(buf)) snprintf(buf + n, sizeof(buf) - n, "us");
+        canvas_draw_str(canvas, 0, SCREEN_H - 46, buf);
+    } else if(app->foam.on) {
+        snprintf(
+            buf,
+            sizeof(buf),
+            "foam %d zz%d %luus",
+            __builtin_popcountll(app->foam.members),
+            __builtin_popcountll(app->foam.asleep),
+            (unsigned long)(app->foam.cycles / cpu));
+        canvas_draw_str(canvas, 0, SCREEN_H - 46, buf);
+    }
+
+    if(app->stick.chance_pct) {
+        snprintf(
+            buf,
+            sizeof(buf),
+            "stick e%u c%u max%u %luus",
+            (unsigned)app->stick.edge_count,
+            (unsigned)app->stick.clusters,
+            (unsigned)app->stick.largest,
+            (unsigned long)(app->stick.cycles / cpu));
+        canvas_draw_str(canvas, 0, SCREEN_H - 55, buf);
+    } else if(app->water.on) {
+        uint32_t ppm = water_budget_ppm(app->water.update_cycles + app->water.draw_cycles);
+        snprintf(
+            buf,
+            sizeof(buf),
+            "water u%lu d%lu %lu.%02lu%%",
+            (unsigned long)app->water.update_cycles,
+            (unsigned long)app->water.draw_cycles,
+            (unsigned long)(ppm / 10000),
+            (unsigned long)(ppm / 100 % 100));
+        canvas_draw_str(canvas, 0, SCREEN_H - 55, buf);
+    }
+
+    if(app->blast.radius > 0.0f) {
+        snprintf(
+            buf,
+            sizeof(buf),
+            "blast %luus q%lu",
+            (unsigned long)(app->perf.blast_cycles / cpu),
+            (unsigned long)app->perf.step_blast_queries);
+        canvas_draw_str(canvas, 0, SCREEN_H - 28, buf);
+    }
+
+    snprintf(
+        buf,
+        sizeof(buf),
+        "%luus %lukc/sim-s",
+        (unsigned long)(app->perf.step_cycles / cpu),
+        (unsigned long)(app->perf.cycles_per_sim_s / 1000));
+    canvas_draw_str(canvas, 0, SCREEN_H - 1, buf);
+}
+
+// Stats page: one line per group with collisions, pops, top respawns and
+// the share of body-frames spent in spawn cooldown
+static void bubble_draw_stats(Canvas* canvas, const BubbleApp* app) {
+    canvas_set_font(canvas, FontSecondary);
+    char buf[64];
+    const PhysicsStats* st = &app->stats;
+
+    for(int g = 0; g < GROUP_COUNT; g++) {
+        uint32_t live = st->live_frames[g];
+        uint32_t cd_pct = live ? (uint32_t)(st->cooldown_frames[g] * 100ull / live) : 0;
+        snprintf(
+            buf,
+            sizeof(buf),
+            "%c c%lu p%lu t%lu cd%lu%%",
+            app->groups[g].name[0],
+            (unsigned long)st->collisions[g],
+            (unsigned long)st->pops[g],
+            (unsigned long)st->respawns_top[g],
+            (unsigned long)cd_pct);
+        canvas_draw_str(canvas, 0, SCREEN_H - 1 - 9 * (GROUP_COUNT - 1 - g), buf);
+    }
+}
+
+// Tasks page: per main loop task, the average time per frame and the longest
+// run over the last second, its budget, then overruns for foreground tasks
+// (`!`) or frames spent waiting for time for background ones (`w`)
+static void bubble_draw_tasks(Canvas* canvas, const BubbleApp* app) {
+    canvas_set_font(canvas, FontSecondary);
+    char buf[48];
+
+    for(size_t id = 0; id < SchedTaskCountEnum; id++) {
+        const SchedTaskInfo* info = &sched_task_info[id];
+        const SchedTask* task = &app->sched.tasks[id];
+        snprintf(
+            buf,
+            sizeof(buf),
+            "%-6s %4lu %5lu/%lu %c%lu",
+            info->name,
+            (unsigned long)task->avg_us,
+            (unsigned long)task->max_us,
+            (unsigned long)info->budget_us,
+            info->foreground ? '!' : 'w',
+            (unsigned long)(info->foreground ? task->overruns : task->deferred));
+        canvas_draw_str(canvas, 0, 7 + 8 * (int)id, buf);
+    }
+}
+
+// Backends page: every physics backend's average step time while it ran,
+// side by side; Left/Right switches, the current one is marked
+static void bubble_draw_backends(Canvas* canvas, const BubbleApp* app) {
+    canvas_set_font(canvas, FontSecondary);
+    char buf[40];
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+
+    const char* title = "Backends </>";
+    if(app->compare) title = "Backends (off in Compare)";
+    if(bubble_layered(app)) title = "Backends (off in Layers)";
+    canvas_draw_str(canvas, 0, 8, title);
+    for(size_t m = 0; m < PhysicsModeCountEnum; m++) {
+        const BackendStats* bs = &app->backend_stats[m];
+        if(bs->frames) {
+            snprintf(
+                buf,
+                sizeof(buf),
+                "%c%-7s%5luus n%lu",
+                m == app->physics_mode ? '>' : ' ',
+                physics_mode_names[m],
+                (unsigned long)(bs->avg_cycles / cpu),
+                (unsigned long)bs->frames);
+        } else {
+            snprintf(
+                buf,
+                sizeof(buf),
+                "%c%-7s    -",
+                m == app->physics_mode ? '>' : ' ',
+                physics_mode_names[m]);
+        }
+        canvas_draw_str(canvas, 0, 17 + 9 * (int)m, buf);
+    }
+}
+
+// Compare mode: divider plus each world's label and own step time; the
+// world being edited is starred
+static void bubble_draw_compare(Canvas* canvas, BubbleApp* app) {
+    canvas_set_font(canvas, FontSecondary);
+    canvas_draw_line(canvas, SCREEN_W / 2 - 1, 0, SCREEN_W / 2 - 1, SCREEN_H - 1);
+
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+    char buf[24];
+    for(int w = 0; w < COMPARE_WORLDS; w++) {
+        const PhysicsWorld* world = &app->worlds[w];
+        snprintf(
+            buf,
+            sizeof(buf),
+            "%c%s %luus",
+            'A' + w,
+            (app->hud_page != HudPageHidden && w == app->edit_world) ? "*" : "",
+            (unsigned long)(world->step_cycles / cpu));
+        canvas_draw_str(canvas, (int)world->bounds.min_x + 1, 7, buf);
+    }
+}
+
+// Crosshair with a dotted ring at the force field's reach
+static void bubble_draw_cursor(Canvas* canvas, const BubbleCursor* cur) {
+    int x = (int)cur->x;
+    int y = (int)cur->y;
+    canvas_set_color(canvas, ColorXOR);
+    canvas_draw_line(canvas, x - 3, y, x + 3, y);
+    canvas_draw_line(canvas, x, y - 3, x, y + 3);
+    for(int i = 0; i < 24; i++) {
+        float a = (float)i * (6.2831853f / 24.0f);
+        canvas_draw_dot(
+            canvas, x + (int)(cosf(a) * CURSOR_RADIUS), y + (int)(sinf(a) * CURSOR_RADIUS));
+    }
+    canvas_set_color(canvas, ColorBlack);
+}
+
+static void bubble_draw(Canvas* canvas, void* ctx) {
+    BubbleApp* app = ctx;
+    uint32_t start = perf_cycles();
+
+    // Bodies: blit the render-ahead frame, or draw them here
+    if(!bubble_blit_ahead(app, canvas)) {
+        canvas_clear(canvas);
+        DrawTarget target = {.canvas = canvas, .style = app->render_style};
+        if(canvas_get_buffer_size(canvas) == FB_SIZE) {
+            target.spans = canvas_get_buffer(canvas);
+            fizz_draw(&app->fizz, target.spans);
+            water_draw(&app->water, target.spans);
+        }
+        bubble_draw_bodies(app, &target);
+    }
+
+    if(app->compare) {
+        bubble_draw_compare(canvas, app);
+    }
+
+    if(app->cursor.active) {
+        bubble_draw_cursor(canvas, &app->cursor);
+    }
+
+    // Footer: show which field is being edited + value (config page only),
+    // or the progress of a benchmark run
+    const char* bench = app->bench_running;
+    if(bench) {
+        canvas_set_font(canvas, FontSecondary);
+        char buf[48];
+        snprintf(
+            buf,
+            sizeof(buf),
+            "Bench %s %lu/%lu",
+            bench,
+            (unsigned long)app->bench_frame,
+            (unsigned long)app->bench_frames);
+        canvas_draw_str(canvas, 0, SCREEN_H - 1, buf);
+    } else if(app->hud_page == HudPageConfig) {
+        BubbleGroupConfig* cfg = &bubble_edit_groups(app)[app->selected_group];
+
+        canvas_set_font(canvas, FontSecondary);
+        char buf[32];
+        const char* locked_by = bubble_field_locked_by(app, app->menu_field);
+
+        switch(app->menu_field) {
+            case ConfigFieldCount:
+                snprintf(buf, sizeof(buf), "Count=%d", cfg->count);
+                break;
+            case ConfigFieldRadius:
+                snprintf(buf, sizeof(buf), "Radius=%.1f", (double)cfg->radius);
+                break;
+            case ConfigFieldSpeed:
+                snprintf(buf, sizeof(buf), "Speed=%.2f", (double)cfg->rise_speed);
+                break;
+            case ConfigFieldRestitution: {
+                int res = (int)(cfg->restitution * 100.0f + 0.5f); // round to nearest int
+                snprintf(buf, sizeof(buf), "Bounce=%d%%", res);
+                break;
+            }
+            case ConfigFieldPopChance: {
+                int pct = (int)(cfg->pop_chance * 100.0f + 0.5f); // round to nearest int
+                snprintf(buf, sizeof(buf), "Pop=%d%%", pct);
+                break;
+            }
+            case ConfigFieldPhysics:
+                if(locked_by) {
+                    snprintf(buf, sizeof(buf), "Physics=Step (%s)", locked_by);
+                } else {
+                    snprintf(
+                        buf, sizeof(buf), "Physics=%s", physics_mode_names[app->physics_mode]);
+                }
+                break;
+            case ConfigFieldCompare:
+                snprintf(buf, sizeof(buf), "Compare=%s", app->compare ? "On" : "Off");
+                break;
+            case ConfigFieldLayers:
+                if(app->layer_count > 1) {
+                    snprintf(buf, sizeof(buf), "Layers=%u", (unsigned)app->layer_count);
+                } else {
+                    snprintf(buf, sizeof(buf), "Layers=Off");
+                }
+                break;
+            case ConfigFieldRender:
+                snprintf(buf, sizeof(buf), "Render=%s", render_mode_names[app->render_mode]);
+                break;
+            case ConfigFieldStyle:
+                snprintf(buf, sizeof(buf), "Style=%s", render_style_names[app->render_style]);
+                break;
+            case ConfigFieldFizz:
+                if(app->fizz.count) {
+                    snprintf(buf, sizeof(buf), "Fizz=%u", (unsigned)app->fizz.count);
+                } else {
+                    snprintf(buf, sizeof(buf), "Fizz=Off");
+                }
+                break;
+            case ConfigFieldWater:
+                snprintf(buf, sizeof(buf), "Water=%s", app->water.on ? "On" : "Off");
+                break;
+            case ConfigFieldFoam:
+                if(locked_by) {
+                    snprintf(buf, sizeof(buf), "Foam=Off (%s)", locked_by);
+                } else {
+                    snprintf(buf, sizeof(buf), "Foam=%s", app->foam.on ? "On" : "Off");
+                }
+                break;
+            case ConfigFieldStick:
+                if(app->stick.chance_pct) {
+                    snprintf(buf, sizeof(buf), "Stick=%u%%", (unsigned)app->stick.chance_pct);
+                } else {
+                    snprintf(buf, sizeof(buf), "Stick=Off");
+                }
+                break;
+            case ConfigFieldBroadphase:
+                if(!app->broad_auto) {
+                    snprintf(
+                        buf, sizeof(buf), "Broad=%s", broadphase_settings[app->broad_setting].name);
+                } else if(app->tuner.run) {
+                    snprintf(buf, sizeof(buf), "Broad=Auto ...");
+                } else {
+                    snprintf(
+                        buf,
+                        sizeof(buf),
+                        "Broad=Auto %s",
+                        broadphase_settings[app->broad_setting].name);
+                }
+                break;
+            case ConfigFieldBlast:
+                if(app->blast.radius > 0.0f) {
+                    snprintf(buf, sizeof(buf), "Blast=%dpx", (int)app->blast.radius);
+                } else {
+                    snprintf(buf, sizeof(buf), "Blast=Off");
+                }
+                break;
+            case ConfigFieldChain:
+                snprintf(
+                    buf, sizeof(buf), "Chain=%d%%", (int)(app->blast.chain_chance * 100.0f + 0.5f));
+                break;
+            case ConfigFieldFeedback:
+                snprintf(buf, sizeof(buf), "Feedback=%s", feedback_mode_names[app->feedback.mode]);
+                break;
+            case ConfigFieldCursor:
+                if(app->cursor.active) {
+                    // Live force cost while the cursor has the keys
+                    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+                    snprintf(
+                        buf,
+                        sizeof(buf),
+                        "%s %luus n%u",
+                        cursor_mode_names[app->cursor.mode],
+                        (unsigned long)(app->cursor.cycles / cpu),
+                        (unsigned)app->cursor.reached);
+                } else {
+                    snprintf(buf, sizeof(buf), "Cursor=%s", cursor_mode_names[app->cursor.mode]);
+                }
+                break;
+            case ConfigFieldRecord:
+                if(app->rec.mode == RecModeOff) {
+                    snprintf(buf, sizeof(buf), "Rec=Off");
+                } else if(!app->rec.file) {
+                    snprintf(buf, sizeof(buf), "Rec=%s (SD?)", rec_mode_names[app->rec.mode]);
+                } else {
+                    snprintf(
+                        buf,
+                        sizeof(buf),
+                        "Rec=%s %luKB",
+                        rec_mode_names[app->rec.mode],
+                        (unsigned long)((app->rec.bytes + app->rec.used) / 1024));
+                }
+                break;
+            case ConfigFieldBench:
+                if(!app->bench_file_count) {
+                    snprintf(buf, sizeof(buf), "Bench=none");
+                } else {
+                    snprintf(
+                        buf,
+                        sizeof(buf),
+                        "Bench=%s",
+                        app->bench_selected ? app->bench_files[app->bench_selected - 1] : "All");
+                }
+                break;
+            default:
+                snprintf(buf, sizeof(buf), "?");
+                break;
+        }
+
+        // bottom line: y = SCREEN_H - 1
+        canvas_draw_str(canvas, 0, SCREEN_H - 1, buf);
+    } else if(app->hud_page == HudPagePerf) {
+        bubble_draw_perf(canvas, app);
+    } else if(app->hud_page == HudPageStats) {
+        bubble_draw_stats(canvas, app);
+    } else if(app->hud_page == HudPageTasks) {
+        bubble_draw_tasks(canvas, app);
+    } else if(app->hud_page == HudPageBackends) {
+        bubble_draw_backends(canvas, app);
+    }
+
+    app->perf.draw_cycles = perf_cycles() - start;
+}
+
+// --- Cursor force field -----------------------------------------------------
+//
+// OK on the Cursor field hands the D-pad to a cursor. Bubbles whose rim is
+// within CURSOR_RADIUS of it are pushed away (or pulled in) through ax/ay,
+// strongest at the cursor and fading to nothing at the edge. The bubbles
+// come from a circle query each frame, so the cost follows the bubbles near
+// the cursor rather than the body count.
+
+// Query index over the bodies as they are now, built on first use after
+// each step. In compare mode it covers one world; *bodies gets the start of
+// that world's slice, which query results index into.
+static const Broadphase* bubble_query_index(BubbleApp* app, int world, PhysicsBody** bodies) {
+    PhysicsBody* first = app->bodies;
+    size_t count = app->body_count;
+    const WorldBounds* bounds = &app->bounds;
+    if(app->compare) {
+        first += app->worlds[world].first;
+        count = app->worlds[world].count;
+        bounds = &app->worlds[world].bounds;
+    }
+
+    Broadphase* bp = &app->broad;
+    if(!bp->query_ready || bp->query_bodies != first || bp->query_count != count) {
+        broadphase_index(bp, first, count, bounds);
+    }
+    if(bodies) *bodies = first;
+    return bp;
+}
+
+// Cursor mode owns the keys: arrows move it while held, OK flips repel and
+// attract, Back hands the keys back to the HUD
+static void bubble_cursor_input(BubbleApp* app, const InputEvent* in) {
+    BubbleCursor* cur = &app->cursor;
+    if(in->key == InputKeyUp || in->key == InputKeyDown || in->key == InputKeyLeft ||
+       in->key == InputKeyRight) {
+        if(in->type == InputTypePress) cur->held |= 1u << in->key;
+        if(in->type == InputTypeRelease) cur->held &= ~(1u << in->key);
+    } else if(in->type == InputTypeShort && in->key == InputKeyOk) {
+        cur->mode = (CursorMode)((cur->mode + 1) % CursorModeCountEnum);
+    } else if(in->type == InputTypeShort && in->key == InputKeyBack) {
+        cur->active = false;
+        cur->held = 0;
+    }
+}
+
+// Move the cursor by the held arrows, clear last frame's forces and set new
+// ones on the bubbles in range. Runs before the step that integrates them.
+static void bubble_cursor_apply(BubbleApp* app, float dt) {
+    BubbleCursor* cur = &app->cursor;
+    if(!cur->active && !cur->pushed) return;
+    uint32_t start = perf_cycles();
+
+    for(size_t i = 0; i < BP_MAX_BODIES; i++) {
+        if(!(cur->pushed & (1ull << i))) continue;
+        PhysicsBody* b = &app->bodies[cur->pushed_first + i];
+        b->ax = 0.0f;
+        b->ay = 0.0f;
+    }
+    cur->pushed = 0;
+    cur->reached = 0;
+
+    if(cur->active) {
+        uint8_t held = cur->held;
+        float mx = (float)(!!(held & (1u << InputKeyRight)) - !!(held & (1u << InputKeyLeft)));
+        float my = (float)(!!(held & (1u << InputKeyDown)) - !!(held & (1u << InputKeyUp)));
+        cur->x += mx * CURSOR_SPEED * dt;
+        cur->y += my * CURSOR_SPEED * dt;
+        if(cur->x < 0.0f) cur->x = 0.0f;
+        if(cur->x > (float)(SCREEN_W - 1)) cur->x = (float)(SCREEN_W - 1);
+        if(cur->y < 0.0f) cur->y = 0.0f;
+        if(cur->y > (float)(SCREEN_H - 1)) cur->y = (float)(SCREEN_H - 1);
+
+        int world = 0;
+        while(app->compare && world + 1 < COMPARE_WORLDS &&
+              cur->x > app->worlds[world].bounds.max_x) {
+            world++;
+        }
+        PhysicsBody* bodies;
+        const Broadphase* bp = bubble_query_index(app, world, &bodies);
+        uint8_t hits[BP_MAX_BODIES];
+        size_t n = broadphase_query_circle(bp, cur->x, cur->y, CURSOR_RADIUS, hits, BP_MAX_BODIES);
+
+        float sign = cur->mode == CursorModeRepel ? 1.0f : -1.0f;
+        for(size_t k = 0; k < n; k++) {
+            PhysicsBody* b = &bodies[hits[k]];
+            float dx = b->x - cur->x;
+            float dy = b->y - cur->y;
+            float dist = sqrtf(ph_len2(dx, dy));
+            if(dist < 0.001f) continue; // dead centre, no direction to push
+            float gap = dist - b->radius;
+            float falloff = gap > 0.0f ? 1.0f - gap / CURSOR_RADIUS : 1.0f;
+            float a = sign * CURSOR_ACCEL * falloff / dist;
+            b->ax = dx * a;
+            b->ay = dy * a;
+            cur->pushed |= 1ull << hits[k];
+        }
+        cur->pushed_first = (size_t)(bodies - app->bodies);
+        cur->reached = (uint8_t)n;
+    }
+    cur->cycles = perf_cycles() - start;
+}
+
+// --- Input handling ---------------------------------------------------------
+
+static void bubble_input_cb(InputEvent* input, void* ctx) {
+    BubbleApp* app = ctx;
+    BubbleEvent ev = {.type = EventTypeInput, .input = *input};
+    furi_message_queue_put(app->queue, &ev, 0);
+}
+
+// Write edited group configs: from the config task once edits settle, and
+// on exit for anything still unsaved
+static void bubble_persist_config(BubbleApp* app) {
+    if(app->config_dirty & 1u) bubble_save_config(app->groups, BUBBLE_CFG_PATH);
+    if(app->config_dirty & 2u) bubble_save_config(app->groups_b, BUBBLE_CFG_B_PATH);
+    app->config_dirty = 0;
+}
+
+static void bubble_save_and_reinit(BubbleApp* app) {
+    bubble_app_reinit_group(app, app->selected_group);
+    if(!app->bench_running) { // scenario edits are not the user's settings
+        app->config_dirty |= (uint8_t)(1u << (app->compare ? app->edit_world : 0));
+        app->config_changed = app->sched.frame;
+        sched_wake(&app->sched, SchedTaskConfig);
+        if(app->broad_auto) sched_wake(&app->sched, SchedTaskTune);
+    }
+    memset(&app->stats, 0, sizeof(app->stats));
+}
+
+static void bubble_adjust_field(BubbleApp* app, int dir) {
+    BubbleGroupConfig* cfg = &bubble_edit_groups(app)[app->selected_group];
+    if(bubble_field_locked_by(app, app->menu_field)) return;
+
+    switch(app->menu_field) {
+        case ConfigFieldCount:
+            cfg->count += dir;
+            if(cfg->count < 0) cfg->count = 0;
+            if(cfg->count > BUBBLE_MAX_COUNT) cfg->count = BUBBLE_MAX_COUNT;
+            bubble_save_and_reinit(app);
+            break;
+
+        case ConfigFieldRadius:
+            cfg->radius += (float)dir * 0.25f;
+            if(cfg->radius < BUBBLE_MIN_RADIUS) cfg->radius = BUBBLE_MIN_RADIUS;
+            if(cfg->radius > BUBBLE_MAX_RADIUS) cfg->radius = BUBBLE_MAX_RADIUS;
+            bubble_save_and_reinit(app);
+            break;
+
+        case ConfigFieldSpeed:
+            cfg->rise_speed += (float)dir * 1.0f;
+            if(cfg->rise_speed < BUBBLE_MIN_SPEED) cfg->rise_speed = BUBBLE_MIN_SPEED;
+            if(cfg->rise_speed > BUBBLE_MAX_SPEED) cfg->rise_speed = BUBBLE_MAX_SPEED;
+            bubble_save_and_reinit(app);
+            break;
+
+        case ConfigFieldRestitution:
+            cfg->restitution += (float)dir * 0.01f;
+            if(cfg->restitution < BUBBLE_MIN_RESTITUTION) cfg->restitution = BUBBLE_MIN_RESTITUTION;
+            if(cfg->restitution > BUBBLE_MAX_RESTITUTION) cfg->restitution = BUBBLE_MAX_RESTITUTION;
+            bubble_save_and_reinit(app);
+            break;
+
+        case ConfigFieldPopChance:
+            cfg->pop_chance += (float)dir * 0.01f;
+            if(cfg->pop_chance < BUBBLE_MIN_POP) cfg->pop_chance = BUBBLE_MIN_POP;
+            if(cfg->pop_chance > BUBBLE_MAX_POP) cfg->pop_chance = BUBBLE_MAX_POP;
+            bubble_save_and_reinit(app);
+            break;
+
+        case ConfigFieldPhysics:
+            bubble_set_backend(
+                app,
+                (PhysicsMode)((app->physics_mode + PhysicsModeCountEnum + dir) %
+                              PhysicsModeCountEnum));
+            break;
+
+        case ConfigFieldCompare:
+            app->compare = !app->compare;
+            app->edit_world = 0;
+            bubble_app_build_bodies(app);
+            memset(&app->stats, 0, sizeof(app->stats));
+            break;
+
+        case ConfigFieldLayers: {
+            size_t step = 0;
+            while(step + 1 < LAYER_COUNT_STEPS && layer_counts[step] < app->layer_count) step++;
+            step = (step + LAYER_COUNT_STEPS + (size_t)dir) % LAYER_COUNT_STEPS;
+            app->layer_count = layer_counts[step];
+            bubble_app_build_bodies(app);
+            memset(&app->stats, 0, sizeof(app->stats));
+            break;
+        }
+
+        case ConfigFieldRender:
+            app->render_mode =
+                (RenderMode)((app->render_mode + RenderModeCountEnum + dir) % RenderModeCountEnum);
+            app->render.ready = false;
+            break;
+
+        case ConfigFieldStyle:
+            app->render_style = (RenderStyle)((app->render_style + RenderStyleCountEnum + dir) %
+                                              RenderStyleCountEnum);
+            break;
+
+        case ConfigFieldFizz: {
+            size_t step = 0;
+            while(step + 1 < FIZZ_COUNT_STEPS && fizz_counts[step] < app->fizz.count) step++;
+            step = (step + FIZZ_COUNT_STEPS + (size_t)dir) % FIZZ_COUNT_STEPS;
+            fizz_set_count(&app->fizz, fizz_counts[step]);
+            break;
+        }
+
+        case ConfigFieldWater:
+            app->water.on = !app->water.on;
+            water_reset(&app->water);
+            break;
+
+        case ConfigFieldFoam:
+            app->foam.on = !app->foam.on;
+            if(!app->foam.on) foam_reset(&app->foam, app->bodies, app->body_count);
+            break;
+
+        case ConfigFieldStick: {
+            size_t step = 0;
+            while(step + 1 < STICK_CHANCE_STEPS && stick_chances[step] < app->stick.chance_pct) {
+                step++;
+            }
+            step = (step + STICK_CHANCE_STEPS + (size_t)dir) % STICK_CHANCE_STEPS;
+            stick_set_chance(app, stick_chances[step]);
+            break;
+        }
+
+        case ConfigFieldBroadphase: {
+            // Every setting, then Auto
+            int choices = (int)BROADPHASE_SETTING_COUNT + 1;
+            int at = app->broad_auto ? choices - 1 : (int)app->broad_setting;
+            at = (at + choices + dir) % choices;
+            app->broad_auto = at == choices - 1;
+            if(!app->broad_auto) {
+                app->broad_setting = (size_t)at;
+                bubble_apply_broadphase(app);
+            } else if(app->tuner.hash == tune_config_hash(app)) {
+                bubble_tune_apply(app, app->tuner.pick);
+            } else {
+                sched_wake(&app->sched, SchedTaskTune);
+            }
+            memset(&app->stats, 0, sizeof(app->stats));
+            break;
+        }
+
+        case ConfigFieldBlast:
+            app->blast.radius += (float)dir * BLAST_RADIUS_STEP;
+            if(app->blast.radius < 0.0f) app->blast.radius = 0.0f;
+            if(app->blast.radius > BLAST_MAX_RADIUS) app->blast.radius = BLAST_MAX_RADIUS;
+            memset(&app->stats, 0, sizeof(app->stats));
+            break;
+
+        case ConfigFieldChain:
+            app->blast.chain_chance += (float)dir * 0.1f;
+            if(app->blast.chain_chance < 0.05f) app->blast.chain_chance = 0.0f;
+            if(app->blast.chain_chance > 1.0f) app->blast.chain_chance = 1.0f;
+            memset(&app->stats, 0, sizeof(app->stats));
+            break;
+
+        case ConfigFieldFeedback:
+            bubble_feedback_set_mode(
+                &app->feedback,
+                (FeedbackMode)((app->feedback.mode + FeedbackModeCountEnum + dir) %
+                               FeedbackModeCountEnum));
+            break;
+
+        case ConfigFieldCursor:
+            app->cursor.mode =
+                (CursorMode)((app->cursor.mode + CursorModeCountEnum + dir) % CursorModeCountEnum);
+            break;
+
+        case ConfigFieldBench:
+            if(app->bench_file_count) {
+                size_t n = app->bench_file_count + 1; // "All" first
+                app->bench_selected = (size_t)(((int)app->bench_selected + (int)n + dir) % (int)n);
+            }
+            break;
+
+        case ConfigFieldRecord: {
+            RecMode prev = app->rec.mode;
+            app->rec.mode = (RecMode)((app->rec.mode + RecModeCountEnum + dir) % RecModeCountEnum);
+            // Switching between Bodies and Screen keeps the file going
+            if(app->rec.mode == RecModeOff) {
+                bubble_rec_stop(&app->rec);
+            } else if(prev == RecModeOff && !bubble_rec_start(&app->rec)) {
+                FURI_LOG_I(TAG, "recording: can't create %s", BUBBLE_REC_PATH);
+            }
+            break;
+        }
+
+        default:
+            break;
+    }
+}
+
+static void bubble_handle_input(BubbleApp* app, InputEvent* in, bool* running) {
+    // First, handle long-press OK to cycle HUD pages (config -> perf -> hidden)
+    if((in->type == InputTypeLong) && (in->key == InputKeyOk)) {
+        app->hud_page = (HudPage)((app->hud_page + 1) % HudPageCountEnum);
+        return;
+    }
+
+    if(app->cursor.active) {
+        bubble_cursor_input(app, in);
+        return;
+    }
+
+    // For everything else, we only care about short/repeat events
+    if(!(in->type == InputTypeShort || in->type == InputTypeRepeat)) return;
+
+    switch(in->key) {
+        case InputKeyBack:
+            // Back now exits immediately
+            *running = false;
+            return;
+
+        case InputKeyUp:
+            // Change which property is selected
+            if(app->menu_field == 0) {
+                app->menu_field = (ConfigField)(ConfigFieldCountEnum - 1);
+            } else {
+                app->menu_field = (ConfigField)(app->menu_field - 1);
+            }
+            break;
+
+        case InputKeyDown:
+            // Change which property is selected
+            app->menu_field = (ConfigField)(app->menu_field + 1);
+            if(app->menu_field >= ConfigFieldCountEnum) {
+                app->menu_field = ConfigFieldCount;
+            }
+            break;
+
+        case InputKeyLeft:
+        case InputKeyRight: {
+            int dir = in->key == InputKeyRight ? +1 : -1;
+            if(app->hud_page == HudPageBackends) {
+                // The Backends page switches physics directly
+                if(bubble_field_locked_by(app, ConfigFieldPhysics)) break;
+                bubble_set_backend(
+                    app,
+                    (PhysicsMode)((app->physics_mode + PhysicsModeCountEnum + dir) %
+                                  PhysicsModeCountEnum));
+            } else {
+                // Decrease / increase value of current property
+                bubble_adjust_field(app, dir);
+            }
+            break;
+        }
+
+        case InputKeyOk:
+            if(app->menu_field == ConfigFieldBench) {
+                // Run the selected scenario(s) from the main loop
+                app->bench_request = app->bench_file_count > 0;
+                break;
+            }
+            if(app->menu_field == ConfigFieldCursor) {
+                app->cursor.active = true;
+                break;
+            }
+
+            // Cycle group (Small -> Medium -> Large -> Small ...), and in
+            // compare mode on through world B's groups
+            app->selected_group++;
+            if(app->selected_group >= GROUP_COUNT) {
+                app->selected_group = 0;
+                if(app->compare) app->edit_world = (app->edit_world + 1) % COMPARE_WORLDS;
+            }
+            break;
+
+        default:
+            break;
+    }
+}
+
+// --- Simulation frame -------------------------------------------------------
+
+// Bodies nudged outside the backend step (stick, foam): the event queue
+// reschedules them and Rate steps them next frame with their saved-up time
+static void bubble_touch_bodies(BubbleApp* app, uint64_t touched) {
+    for(; touched; touched &= touched - 1) {
+        size_t i = (size_t)__builtin_ctzll(touched);
+        toi_touch(&app->toi, i);
+        rate_wake(&app->rate, i);
+    }
+}
+
+// Physics in the selected mode, then respawns for popped and escaped bubbles
+static void bubble_app_step(BubbleApp* app, float dt) {
+    bubble_cursor_apply(app, dt);
+
+    // Physics step
+    uint32_t step_start = perf_cycles();
+    uint32_t pair_tests = app->stats.pair_tests;
+    uint64_t blast_cycles = app->stats.blast_cycles;
+    uint32_t blast_queries = app->stats.blast_queries;
+    size_t world_count;
+    PhysicsWorld* worlds = bubble_split_worlds(app, &world_count);
+
+    // Cluster proxies for this step's pair loops; they index one world
+    uint32_t stick_start = perf_cycles();
+    if(!worlds && stick_build_proxies(&app->stick, app->bodies, app->body_count)) {
+        app->broad.near = app->stick.near;
+    }
+    uint32_t stick_cycles = perf_cycles() - stick_start;
+
+    if(worlds) {
+        physics_step_worlds(
+            &app->broad,
+            app->bodies,
+            worlds,
+            world_count,
+            dt,
+            app->gravity_y,
+            &app->blast,
+            &app->stats);
+    } else {
+        physics_backends[app->physics_mode].step(app, dt);
+    }
+    app->broad.near = NULL;
+
+    // Pop blasts and chains; split worlds ran theirs inside their own step
+    if(!worlds &&
+       physics_pop_blasts(
+           &app->broad,
+           app->bodies,
+           app->body_count,
+           &app->bounds,
+           &app->blast,
+           &app->rng,
+           &app->stats)) {
+        toi_invalidate(&app->toi); // velocities changed under the event queue
+    }
+    app->perf.blast_cycles = (uint32_t)(app->stats.blast_cycles - blast_cycles);
+    app->perf.step_blast_queries = app->stats.blast_queries - blast_queries;
+
+    // Constraints of sticky clusters
+    if(app->stick.edge_count || app->stick.clusters) {
+        stick_start = perf_cycles();
+        bubble_touch_bodies(app, stick_solve(&app->stick, app->bodies, app->body_count));
+        stick_cycles += perf_cycles() - stick_start;
+    }
+    app->stick.cycles = stick_cycles;
+
+    // Foam at the surface; it needs the screen as a single world
+    if(app->foam.on && !worlds) {
+        bubble_touch_bodies(
+            app,
+            foam_step(&app->foam, app->bodies, app->body_count, dt, &app->bounds, &app->stats));
+    }
+
+    uint32_t step_cycles = perf_cycles() - step_start;
+    perf_record_step(&app->perf, step_cycles, dt);
+    app->perf.step_pair_tests = app->stats.pair_tests - pair_tests;
+    app->stats.steps++;
+    app->stats.physics_cycles += step_cycles;
+    if(!worlds) bubble_backend_record(app, step_cycles);
+
+    // Handle popped bubbles: respawn them only after pop animation finishes
+    for(size_t i = 0; i < app->body_count; i++) {
+        PhysicsBody* b = &app->bodies[i];
+        if(b->popped && b->pop_anim_timer <= 0) {
+            app->stats.respawns_popped[b->group]++;
+            bubble_respawn_body(app, b);
+            toi_touch(&app->toi, i);
+            rate_touch(&app->rate, i);
+            sim_emit(SimEventRespawn, b, NULL);
+        }
+    }
+
+    // If a bubble floats off the top, respawn well below the screen
+    for(size_t i = 0; i < app->body_count; i++) {
+        PhysicsBody* b = &app->bodies[i];
+        if(!b->popped && b->pop_anim_timer <= 0 &&
+           (b->y + b->radius < app->bounds.min_y - 20.0f)) {
+            app->stats.respawns_top[b->group]++;
+            bubble_respawn_body(app, b);
+            toi_touch(&app->toi, i);
+            rate_touch(&app->rate, i);
+            sim_emit(SimEventRespawn, b, NULL);
+        }
+    }
+
+    app->broad.query_ready = false; // bodies moved
+
+    uint32_t bus_start = perf_cycles();
+    sim_bus_dispatch(&sim_bus);
+    bubble_feedback_flush(&app->feedback, dt);
+    app->perf.bus_cycles = perf_cycles() - bus_start;
+}
+
+// --- Benchmark scenarios ----------------------------------------------------
+//
+// Reproducible runs. A scenario file sets bounds, seed, groups and modes, then
+// runs a fixed number of fixed-dt frames back to back, injecting timed key
+// events through bubble_handle_input so edits cost what they cost when a
+// user makes them. One key=value line per run is appended to bench.txt.
+//
+// One directive per line, '#' starts a comment:
+//   name <text>                      seed <n>
+//   frames <n>                       dt <seconds>
+//   bounds <min_x> <max_x> <min_y> <max_y>
+//   physics Step|Event|Packed|Rate   broad Naive|Grid8|Grid16|Grid32|Bits
+//   render Direct|Ahead              compare on|off
+//   style Outline|Shaded             overdraw <n> (Ahead: draw the bodies n times)
+//   fizz <n>                         (n background particles, up to FIZZ_MAX)
+//   water on|off                     (ripple line at the top, drawn in Ahead)
+//   layers 1|2|4                     (depth layers, groups dealt across them)
+//   foam on|off|awake                (awake: settled foam never sleeps)
+//   stick <0..100>                   (% chance a bouncing pair sticks)
+//   blast <px>                       chain <0..1>
+//   queries <n>                      (1..256 of each spatial query per frame)
+//   subscribers <n>                  (n event bus subscribers to every kind)
+//   feedback Off|Sound|Vibro|Both|Log
+//   group <Small|Medium|Large> [count=<n>] [radius=<px>] [speed=<px/s>]
+//                              [bounce=<0..1>] [pop=<0..1>]
+//   at <frame> press|long|hold <Up|Down|Left|Right|Ok|Back> [<frames>] [on <field>]
+// Unset groups keep the app defaults. "on <field>" selects a HUD field (as
+// named in the footer) first; hold sends the press, a long press after 10
+// frames, a repeat every 5 frames and the release, like the input service.
+
+#define BENCH_MAX_EVENTS 32
+#define BENCH_FILE_MAX 4096       // bytes
+#define BENCH_HIST_BUCKETS 1024   // 2 us each, slower steps land in the last
+#define BENCH_LONG_FRAMES 10
+#define BENCH_REPEAT_FRAMES 5
+#define BENCH_PROGRESS_FRAMES 16 // HUD refresh while running
+#define BENCH_QUERY_KINDS 4       // rect, circle, nearest, ray
+#define BENCH_QUERY_K 4           // nearest-k
+#define BENCH_MAX_QUERIES 256     // of each kind per frame
+#define BENCH_LINE_LEN 768        // one report line
+
+typedef enum {
+    BenchActionPress,
+    BenchActionLong,
+    BenchActionHold,
+} BenchAction;
+
+typedef struct {
+    uint32_t frame;
+    uint16_t frames; // hold length
+    uint8_t action;  // BenchAction
+    uint8_t key;     // InputKey
+    int8_t field;    // ConfigField to select first, -1 for none
+} BenchEvent;
+
+typedef struct {
+    char name[BENCH_NAME_LEN];
+    uint32_t seed;
+    uint32_t frames;
+    float dt;
+    WorldBounds bounds;
+    PhysicsMode physics;
+    size_t broad;
+    RenderMode render;
+    RenderStyle style;
+    uint8_t overdraw;
+    uint16_t fizz;
+    bool water;
+    bool compare;
+    uint8_t layers;
+    uint8_t foam; // 0 off, 1 on, 2 on without sleeping
+    uint8_t stick;
+    BlastConfig blast;
+    uint16_t queries;
+    uint8_t subscribers;
+    FeedbackMode feedback;
+    BubbleGroupConfig groups[GROUP_COUNT];
+    BenchEvent events[BENCH_MAX_EVENTS];
+    size_t event_count;
+} BenchScenario;
+
+// Settings a run overrides, put back afterwards
+typedef struct {
+    BubbleGroupConfig groups[GROUP_COUNT];
+    BubbleGroupConfig groups_b[GROUP_COUNT];
+    WorldBounds bounds;
+    PhysicsMode physics_mode;
+    size_t broad_setting;
+    bool broad_auto;
+    BlastConfig blast;
+    FeedbackMode feedback;
+    RenderMode render_mode;
+    RenderStyle render_style;
+    uint16_t fizz;
+    bool water;
+    bool compare;
+    uint8_t layer_count;
+    bool foam;
+    uint8_t stick;
+    int edit_world;
+    int selected_group;
+    ConfigField menu_field;
+} BenchSaved;
+
+static const char* const config_field_names[ConfigFieldCountEnum] = {
+    "Count",
+    "Radius",
+    "Speed",
+    "Bounce",
+    "Pop",
+    "Physics",
+    "Compare",
+    "Layers",
+    "Render",
+    "Style",
+    "Fizz",
+    "Water",
+    "Foam",
+    "Stick",
+    "Broad",
+    "Blast",
+    "Chain",
+    "Cursor",
+    "Feedback",
+    "Rec",
+    "Bench",
+};
+
+static const char* const input_key_names[InputKeyMAX] = {"Up", "Down", "Right", "Left", "Ok", "Back"};
+
+static const char* const bench_action_names[] = {"press", "long", "hold"};
+
+static const char* const bench_foam_names[] = {"off", "on", "awake"};
+
+static int bench_lookup(const char* word, const char* const* names, size_t count) {
+    for(size_t i = 0; word && i < count; i++) {
+        if(strcmp(word, names[i]) == 0) return (int)i;
+    }
+    return -1;
+}
+
+// Next whitespace-separated word, terminated in place; NULL at end of line
+static char* bench_word(char** cursor) {
+    char* p = *cursor;
+    while(*p == ' ' || *p == '\t' || *p == '\r') p++;
+    if(!*p || *p == '#') {
+        *cursor = p;
+        return NULL;
+    }
+    char* word = p;
+    while(*p && *p != ' ' && *p != '\t' && *p != '\r') p++;
+    if(*p) *p++ = '\0';
+    *cursor = p;
+    return word;
+}
+
+static bool bench_parse_group(BenchScenario* sc, char** cursor) {
+    const char* const group_names[GROUP_COUNT] = {
+        sc->groups[0].name, sc->groups[1].name, sc->groups[2].name};
+    int g = bench_lookup(bench_word(cursor), group_names, GROUP_COUNT);
+    if(g < 0) return false;
+
+    BubbleGroupConfig* cfg = &sc->groups[g];
+    for(char* kv = bench_word(cursor); kv; kv = bench_word(cursor)) {
+        char* value = strchr(kv, '=');
+        if(!value) return false;
+        *value++ = '\0';
+        if(strcmp(kv, "count") == 0) {
+            cfg->count = (int)strtol(value, NULL, 10);
+            if(cfg->count < 0) cfg->count = 0;
+            if(cfg->count > BUBBLE_MAX_COUNT) cfg->count = BUBBLE_MAX_COUNT;
+        } else if(strcmp(kv, "radius") == 0) {
+            cfg->radius = strtof(value, NULL);
+            if(cfg->radius < BUBBLE_MIN_RADIUS) cfg->radius = BUBBLE_MIN_RADIUS;
+            if(cfg->radius > BUBBLE_MAX_RADIUS) cfg->radius = BUBBLE_MAX_RADIUS;
+        } else if(strcmp(kv, "speed") == 0) {
+            cfg->rise_speed = strtof(value, NULL);
+            if(cfg->rise_speed < BUBBLE_MIN_SPEED) cfg->rise_speed = BUBBLE_MIN_SPEED;
+            if(cfg->rise_speed > BUBBLE_MAX_SPEED) cfg->rise_speed = BUBBLE_MAX_SPEED;
+        } else if(strcmp(kv, "bounce") == 0) {
+            cfg->restitution = strtof(value, NULL);
+            if(cfg->restitution < BUBBLE_MIN_RESTITUTION) cfg->restitution = BUBBLE_MIN_RESTITUTION;
+            if(cfg->restitution > BUBBLE_MAX_RESTITUTION) cfg->restitution = BUBBLE_MAX_RESTITUTION;
+        } else if(strcmp(kv, "pop") == 0) {
+            cfg->pop_chance = strtof(value, NULL);
+            if(cfg->pop_chance < BUBBLE_MIN_POP) cfg->pop_chance = BUBBLE_MIN_POP;
+            if(cfg->pop_chance > BUBBLE_MAX_POP) cfg->pop_chance = BUBBLE_MAX_POP;
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bench_parse_event(BenchScenario* sc, char* frame, char** cursor) {
+    if(!frame || sc->event_count >= BENCH_MAX_EVENTS) return false;
+    BenchEvent* ev = &sc->events[sc->event_count];
+    ev->frame = (uint32_t)strtoul(frame, NULL, 10);
+    ev->frames = 0;
+    ev->field = -1;
+
+    int action = bench_lookup(
+        bench_word(cursor),
+        bench_action_names,
+        sizeof(bench_action_names) / sizeof(bench_action_names[0]));
+    int key = bench_lookup(bench_word(cursor), input_key_names, InputKeyMAX);
+    if(action < 0 || key < 0) return false;
+    ev->action = (uint8_t)action;
+    ev->key = (uint8_t)key;
+
+    char* word = bench_word(cursor);
+    if(word && action == BenchActionHold && strcmp(word, "on") != 0) {
+        ev->frames = (uint16_t)strtoul(word, NULL, 10);
+        word = bench_word(cursor);
+    }
+    if(action == BenchActionHold && ev->frames == 0) return false;
+    if(word) {
+        if(strcmp(word, "on") != 0) return false;
+        int field = bench_lookup(bench_word(cursor), config_field_names, ConfigFieldCountEnum);
+        if(field < 0) return false;
+        ev->field = (int8_t)field;
+    }
 
-    bubble_init_wobble(app, b);
+    sc->event_count++;
+    return true;
 }
 
-// --- Drawing ----------------------------------------------------------------
+static bool bench_parse_line(BenchScenario* sc, char* line) {
+    char* cursor = line;
+    char* cmd = bench_word(&cursor);
+    if(!cmd) return true; // blank or comment
+
+    if(strcmp(cmd, "group") == 0) return bench_parse_group(sc, &cursor);
+
+    char* arg = bench_word(&cursor);
+    if(!arg) return false;
+
+    if(strcmp(cmd, "name") == 0) {
+        strncpy(sc->name, arg, sizeof(sc->name) - 1);
+        sc->name[sizeof(sc->name) - 1] = '\0';
+    } else if(strcmp(cmd, "seed") == 0) {
+        sc->seed = (uint32_t)strtoul(arg, NULL, 0);
+    } else if(strcmp(cmd, "frames") == 0) {
+        sc->frames = (uint32_t)strtoul(arg, NULL, 10);
+    } else if(strcmp(cmd, "dt") == 0) {
+        sc->dt = strtof(arg, NULL);
+        if(sc->dt <= 0.0f) return false;
+    } else if(strcmp(cmd, "bounds") == 0) {
+        char* v[3] = {bench_word(&cursor), bench_word(&cursor), bench_word(&cursor)};
+        if(!v[0] || !v[1] || !v[2]) return false;
+        sc->bounds.min_x = strtof(arg, NULL);
+        sc->bounds.max_x = strtof(v[0], NULL);
+        sc->bounds.min_y = strtof(v[1], NULL);
+        sc->bounds.max_y = strtof(v[2], NULL);
+    } else if(strcmp(cmd, "physics") == 0) {
+        int mode = bench_lookup(arg, physics_mode_names, PhysicsModeCountEnum);
+        if(mode < 0) return false;
+        sc->physics = (PhysicsMode)mode;
+    } else if(strcmp(cmd, "broad") == 0) {
+        size_t i = 0;
+        while(i < BROADPHASE_SETTING_COUNT && strcmp(arg, broadphase_settings[i].name) != 0) i++;
+        if(i == BROADPHASE_SETTING_COUNT) return false;
+        sc->broad = i;
+    } else if(strcmp(cmd, "render") == 0) {
+        int mode = bench_lookup(arg, render_mode_names, RenderModeCountEnum);
+        if(mode < 0) return false;
+        sc->render = (RenderMode)mode;
+    } else if(strcmp(cmd, "style") == 0) {
+        int style = bench_lookup(arg, render_style_names, RenderStyleCountEnum);
+        if(style < 0) return false;
+        sc->style = (RenderStyle)style;
+    } else if(strcmp(cmd, "fizz") == 0) {
+        unsigned long n = strtoul(arg, NULL, 10);
+        if(n > FIZZ_MAX) return false;
+        sc->fizz = (uint16_t)n;
+    } else if(strcmp(cmd, "water") == 0) {
+        sc->water = strcmp(arg, "on") == 0;
+    } else if(strcmp(cmd, "overdraw") == 0) {
+        unsigned long n = strtoul(arg, NULL, 10);
+        if(n < 1 || n > 16) return false;
+        sc->overdraw = (uint8_t)n;
+    } else if(strcmp(cmd, "compare") == 0) {
+        sc->compare = strcmp(arg, "on") == 0;
+    } else if(strcmp(cmd, "layers") == 0) {
+        unsigned long n = strtoul(arg, NULL, 10);
+        if(n != 1 && n != 2 && n != LAYER_MAX) return false;
+        sc->layers = (uint8_t)n;
+    } else if(strcmp(cmd, "foam") == 0) {
+        int mode = bench_lookup(arg, bench_foam_names, 3);
+        if(mode < 0) return false;
+        sc->foam = (uint8_t)mode;
+    } else if(strcmp(cmd, "stick") == 0) {
+        unsigned long pct = strtoul(arg, NULL, 10);
+        if(pct > 100) return false;
+        sc->stick = (uint8_t)pct;
+    } else if(strcmp(cmd, "blast") == 0) {
+        sc->blast.radius = strtof(arg, NULL);
+        if(sc->blast.radius < 0.0f || sc->blast.radius > BLAST_MAX_RADIUS) return false;
+    } else if(strcmp(cmd, "feedback") == 0) {
+        int mode = bench_lookup(arg, feedback_mode_names, FeedbackModeCountEnum);
+        if(mode < 0) return false;
+        sc->feedback = (FeedbackMode)mode;
+    } else if(strcmp(cmd, "subscribers") == 0) {
+        unsigned long n = strtoul(arg, NULL, 10);
+        if(n > SIM_BUS_MAX_SUBSCRIBERS) return false;
+        sc->subscribers = (uint8_t)n;
+    } else if(strcmp(cmd, "queries") == 0) {
+        unsigned long n = strtoul(arg, NULL, 10);
+        if(n == 0 || n > BENCH_MAX_QUERIES) return false;
+        sc->queries = (uint16_t)n;
+    } else if(strcmp(cmd, "chain") == 0) {
+        sc->blast.chain_chance = strtof(arg, NULL);
+        if(sc->blast.chain_chance < 0.0f || sc->blast.chain_chance > 1.0f) return false;
+    } else if(strcmp(cmd, "at") == 0) {
+        return bench_parse_event(sc, arg, &cursor);
+    } else {
+        return false;
+    }
+    return true;
+}
 
-static void bubble_draw_body(Canvas* canvas, const PhysicsBody* b, bool selected);
+// Parse a scenario file. Returns 0 on success, else the 1-based line number
+// of the first bad line (or 1 if the file can't be read).
+static int bench_load(BenchScenario* sc, const char* path, const char* name) {
+    memset(sc, 0, sizeof(*sc));
+    strncpy(sc->name, name, sizeof(sc->name) - 1);
+    sc->seed = 1;
+    sc->frames = 1000;
+    sc->dt = 0.03f;
+    sc->bounds.max_x = (float)(SCREEN_W - 1);
+    sc->bounds.max_y = (float)(SCREEN_H - 1);
+    bubble_init_default_groups(sc->groups);
 
-static void bubble_draw_pop(Canvas* canvas, const PhysicsBody* b) {
-    int x = (int)(b->x + 0.5f);
-    int y = (int)(b->y + 0.5f);
-    int base_r = (int)(b->radius + 0.5f);
-    if(base_r < 1) base_r = 1;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* file = storage_file_alloc(storage);
+    char* text = malloc(BENCH_FILE_MAX + 1);
+    size_t size = 0;
+    if(text && storage_file_open(file, path, FSAM_READ, FSOM_OPEN_EXISTING)) {
+        size = storage_file_read(file, text, BENCH_FILE_MAX);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
 
-    int t = b->pop_anim_timer;
-    if(t <= 0) return;
+    int bad = size ? 0 : 1;
+    if(size) {
+        text[size] = '\0';
+        int line_no = 1;
+        for(char* line = text; line && !bad; line_no++) {
+            char* next = strchr(line, '\n');
+            if(next) *next++ = '\0';
+            if(!bench_parse_line(sc, line)) bad = line_no;
+            line = next;
+        }
+    }
+    free(text);
+    return bad;
+}
 
-    // POP_ANIM_FRAMES .. 1
-    float alpha = (float)t / (float)POP_ANIM_FRAMES; // 1 -> 0
-    int r_outer = base_r + (int)((1.0f - alpha) * 4.0f + 0.5f);
+static void bench_save_settings(const BubbleApp* app, BenchSaved* saved) {
+    memcpy(saved->groups, app->groups, sizeof(saved->groups));
+    memcpy(saved->groups_b, app->groups_b, sizeof(saved->groups_b));
+    saved->bounds = app->bounds;
+    saved->physics_mode = app->physics_mode;
+    saved->broad_setting = app->broad_setting;
+    saved->broad_auto = app->broad_auto;
+    saved->blast = app->blast;
+    saved->feedback = app->feedback.mode;
+    saved->render_mode = app->render_mode;
+    saved->render_style = app->render_style;
+    saved->fizz = app->fizz.count;
+    saved->water = app->water.on;
+    saved->compare = app->compare;
+    saved->layer_count = app->layer_count;
+    saved->foam = app->foam.on;
+    saved->stick = app->stick.chance_pct;
+    saved->edit_world = app->edit_world;
+    saved->selected_group = app->selected_group;
+    saved->menu_field = app->menu_field;
+}
 
-    // Outer ring
-    canvas_draw_circle(canvas, x, y, r_outer);
+static void bench_restore_settings(BubbleApp* app, const BenchSaved* saved) {
+    memcpy(app->groups, saved->groups, sizeof(app->groups));
+    memcpy(app->groups_b, saved->groups_b, sizeof(app->groups_b));
+    app->bounds = saved->bounds;
+    app->physics_mode = saved->physics_mode;
+    app->broad_setting = saved->broad_setting;
+    app->broad_auto = saved->broad_auto;
+    bubble_apply_broadphase(app);
+    app->blast = saved->blast;
+    bubble_feedback_set_mode(&app->feedback, saved->feedback);
+    app->cursor.active = false;
+    app->cursor.held = 0;
+    app->cursor.pushed = 0;
+    app->render_mode = saved->render_mode;
+    app->render_style = saved->render_style;
+    app->render_overdraw = 0;
+    fizz_set_count(&app->fizz, saved->fizz);
+    app->water.on = saved->water;
+    water_reset(&app->water);
+    app->render.ready = false;
+    app->compare = saved->compare;
+    app->layer_count = saved->layer_count;
+    app->foam.on = saved->foam;
+    app->foam.sleep = true;
+    stick_set_chance(app, saved->stick);
+    app->edit_world = saved->edit_world;
+    app->selected_group = saved->selected_group;
+    app->menu_field = saved->menu_field;
+    app->toi.backoff = 0;
+    bubble_app_build_bodies(app);
+    memset(&app->stats, 0, sizeof(app->stats));
+}
 
-    // Inner ring early in the animation to look like fragments
-    if(t > POP_ANIM_FRAMES / 2 && r_outer > 2) {
-        canvas_draw_circle(canvas, x, y, r_outer - 2);
+typedef struct {
+    uint32_t hist[BENCH_HIST_BUCKETS];
+    uint32_t frames;
+    uint64_t step_cycles;
+    uint32_t step_max;
+    uint32_t blast_max;
+    uint64_t raster_cycles;
+    uint32_t raster_max;
+    uint64_t fizz_update_cycles;
+    uint64_t fizz_draw_cycles;
+    uint64_t water_update_cycles;
+    uint64_t water_draw_cycles;
+    uint64_t layer_cycles[LAYER_MAX];
+    uint64_t foam_cycles;
+    uint32_t foam_max;
+    uint32_t foam_members; // summed over frames
+    uint32_t foam_asleep;
+    uint64_t stick_cycles;
+    uint64_t stick_bucket_cycles[STICK_BUCKETS]; // step time by largest cluster
+    uint32_t stick_bucket_frames[STICK_BUCKETS];
+    uint8_t stick_largest;
+    uint32_t inputs;
+    uint64_t input_cycles;
+    uint32_t input_max;
+    uint32_t wall_ms;
+    PhysicsStats carried; // stats of the run before the last settings reset
+    bool aborted;         // Back, from the scenario or the user
+    bool user_abort;
+    uint64_t bus_cycles;
+    uint32_t bus_max;
+    uint32_t events[SimEventKindCountEnum]; // seen by the first subscriber
+    uint32_t events_dropped;
+    uint32_t rate_body_steps;
+    uint32_t rate_body_frames;
+    uint32_t rate_skipped_pairs;
+    uint32_t feedback_requests;
+    uint32_t feedback_merged;
+    uint32_t feedback_dropped;
+    uint64_t cursor_cycles;
+    uint32_t cursor_max;
+    uint32_t cursor_frames; // with the cursor active
+    uint64_t index_cycles;
+    uint64_t query_cycles[BENCH_QUERY_KINDS];
+    uint32_t query_count; // of each kind
+    char line[BENCH_LINE_LEN]; // the report, here rather than on the app stack
+} BenchResult;
+
+static void bench_stats_add(PhysicsStats* dst, const PhysicsStats* src) {
+    for(int g = 0; g < PHYSICS_MAX_GROUPS; g++) {
+        dst->collisions[g] += src->collisions[g];
+        dst->pops[g] += src->pops[g];
+        dst->respawns_top[g] += src->respawns_top[g];
+        dst->respawns_popped[g] += src->respawns_popped[g];
+        dst->cooldown_frames[g] += src->cooldown_frames[g];
+        dst->live_frames[g] += src->live_frames[g];
     }
+    dst->steps += src->steps;
+    dst->pair_tests += src->pair_tests;
+    dst->chain_pops += src->chain_pops;
+    dst->blast_queries += src->blast_queries;
+    dst->blast_cycles += src->blast_cycles;
+    dst->physics_cycles += src->physics_cycles;
 }
 
-static void bubble_draw_body(Canvas* canvas, const PhysicsBody* b, bool selected) {
-    int x = (int)(b->x + 0.5f);
-    int y = (int)(b->y + 0.5f);
-    int r = (int)(b->radius + 0.5f);
-    if(r < 1) r = 1;
+static void bench_send(BubbleApp* app, BenchResult* res, uint8_t key, InputType type, bool* running) {
+    InputEvent in = {.key = (InputKey)key, .type = type};
+    PhysicsStats before = app->stats;
+    uint32_t start = perf_cycles();
+    bubble_handle_input(app, &in, running);
+    uint32_t cycles = perf_cycles() - start;
+    // Edits restart the app's counters; the run reports totals
+    if(app->stats.steps < before.steps) bench_stats_add(&res->carried, &before);
+    res->inputs++;
+    res->input_cycles += cycles;
+    if(cycles > res->input_max) res->input_max = cycles;
+}
 
-    if(x + r < 0 || x - r >= SCREEN_W) return;
-    if(y + r < 0 || y - r >= SCREEN_H) return;
+// Key events due at this frame, in file order
+static void bench_inputs(
+    BubbleApp* app,
+    const BenchScenario* sc,
+    uint32_t f,
+    BenchResult* res,
+    bool* running
+) {
+    for(size_t i = 0; i < sc->event_count; i++) {
+        const BenchEvent* ev = &sc->events[i];
+        if(f < ev->frame) continue;
+        uint32_t t = f - ev->frame;
+
+        if(t == 0) {
+            if(ev->field >= 0) app->menu_field = (ConfigField)ev->field;
+            bench_send(app, res, ev->key, InputTypePress, running);
+            if(ev->action == BenchActionPress) {
+                bench_send(app, res, ev->key, InputTypeShort, running);
+                bench_send(app, res, ev->key, InputTypeRelease, running);
+            } else if(ev->action == BenchActionLong) {
+                bench_send(app, res, ev->key, InputTypeLong, running);
+                bench_send(app, res, ev->key, InputTypeRelease, running);
+            }
+        } else if(ev->action == BenchActionHold && t <= ev->frames) {
+            if(t == ev->frames) {
+                // Let go; short if it never became a long press
+                if(t < BENCH_LONG_FRAMES) bench_send(app, res, ev->key, InputTypeShort, running);
+                bench_send(app, res, ev->key, InputTypeRelease, running);
+            } else if(t == BENCH_LONG_FRAMES) {
+                bench_send(app, res, ev->key, InputTypeLong, running);
+            } else if(t > BENCH_LONG_FRAMES && (t - BENCH_LONG_FRAMES) % BENCH_REPEAT_FRAMES == 0) {
+                bench_send(app, res, ev->key, InputTypeRepeat, running);
+            }
+        }
+    }
+}
 
-    // 1) Main bubble outline
-    canvas_draw_circle(canvas, x, y, r);
+static bool bench_user_abort(BubbleApp* app) {
+    BubbleEvent ev;
+    while(furi_message_queue_get(app->queue, &ev, 0) == FuriStatusOk) {
+        if(ev.input.key == InputKeyBack && ev.input.type == InputTypeShort) return true;
+    }
+    return false;
+}
 
-    // 2) Inner rim to suggest bubble thickness
-    if(r > 3) {
-        canvas_draw_circle(canvas, x, y, r - 2);
+// Query latency: sc->queries of each kind per frame at random spots, drawn
+// from their own RNG so the simulation and its checksum don't notice
+static void bench_queries(BubbleApp* app, const BenchScenario* sc, SimpleRng* rng, BenchResult* res) {
+    const WorldBounds* bounds = app->compare ? &app->worlds[0].bounds : &app->bounds;
+    const Broadphase* bp = bubble_query_index(app, 0, NULL);
+    res->index_cycles += bp->index_cycles;
+
+    float w = bounds->max_x - bounds->min_x;
+    float h = bounds->max_y - bounds->min_y;
+    uint8_t out[BP_MAX_BODIES];
+    QueryHit hits[BENCH_QUERY_K];
+    for(uint16_t q = 0; q < sc->queries; q++) {
+        float x = bounds->min_x + rng_next_float01(rng) * w;
+        float y = bounds->min_y + rng_next_float01(rng) * h;
+        float dx = rng_next_float01(rng) - 0.5f;
+        float dy = rng_next_float01(rng) - 0.5f;
+        uint32_t t[BENCH_QUERY_KINDS + 1];
+
+        t[0] = perf_cycles();
+        broadphase_query_rect(bp, x - 12.0f, y - 8.0f, x + 12.0f, y + 8.0f, out, BP_MAX_BODIES);
+        t[1] = perf_cycles();
+        broadphase_query_circle(bp, x, y, 10.0f, out, BP_MAX_BODIES);
+        t[2] = perf_cycles();
+        broadphase_query_nearest(bp, x, y, BENCH_QUERY_K, hits);
+        t[3] = perf_cycles();
+        broadphase_raycast(bp, x, y, dx, dy, 64.0f, &hits[0]);
+        t[4] = perf_cycles();
+
+        for(int k = 0; k < BENCH_QUERY_KINDS; k++) {
+            res->query_cycles[k] += t[k + 1] - t[k];
+        }
     }
+    res->query_count += sc->queries;
+}
 
-    // 3) Highlight near top-left to sell "glossy bubble"
-    if(r >= 3) {
-        int hx = x - r / 3;
-        int hy = y - r / 3;
-        // Small highlight dot (approximate with a tiny circle)
-        canvas_draw_circle(canvas, hx, hy, 1);
+// Bus subscriber that only counts; the first one's counts are reported
+static void bench_count_event(const SimEvent* event, void* context) {
+    uint32_t* counts = context;
+    counts[event->kind]++;
+}
+
+static void bench_run(BubbleApp* app, const BenchScenario* sc, BenchResult* res) {
+    memset(res, 0, sizeof(*res));
+
+    app->bounds = sc->bounds;
+    memcpy(app->groups, sc->groups, sizeof(app->groups));
+    memcpy(app->groups_b, sc->groups, sizeof(app->groups_b));
+    app->physics_mode = sc->physics;
+    app->broad_setting = sc->broad;
+    app->broad_auto = false; // scenarios time the broadphase they name
+    bubble_apply_broadphase(app);
+    app->blast = sc->blast;
+    bubble_feedback_set_mode(&app->feedback, sc->feedback);
+    memset(&app->cursor, 0, sizeof(app->cursor));
+    app->cursor.x = SCREEN_W / 2;
+    app->cursor.y = SCREEN_H / 2;
+    app->render_mode = sc->render;
+    app->render_style = sc->style;
+    app->render_overdraw = sc->overdraw;
+    fizz_set_count(&app->fizz, sc->fizz); // out of memory reports fizz=0
+    app->water.on = sc->water;
+    water_reset(&app->water);
+    app->render.ready = false;
+    app->compare = sc->compare;
+    app->layer_count = sc->layers ? sc->layers : 1;
+    app->foam.on = sc->foam != 0;
+    app->foam.sleep = sc->foam != 2;
+    stick_set_chance(app, sc->stick);
+    app->edit_world = 0;
+    app->selected_group = 0;
+    app->menu_field = ConfigFieldCount;
+    app->toi.backoff = 0;
+    rng_init(&app->rng, sc->seed);
+    SimpleRng query_rng;
+    rng_init(&query_rng, sc->seed ^ 0x51u);
+    bubble_app_build_bodies(app);
+    memset(&app->stats, 0, sizeof(app->stats));
+    memset(&app->perf, 0, sizeof(app->perf));
+
+    // Distinct contexts, so each registration is its own subscriber
+    static uint32_t spare_counts[SIM_BUS_MAX_SUBSCRIBERS][SimEventKindCountEnum];
+    for(uint8_t i = 0; i < sc->subscribers; i++) {
+        sim_bus_subscribe(
+            &sim_bus, SIM_EVENT_ALL, bench_count_event, i ? spare_counts[i] : res->events);
     }
+    uint32_t dropped = sim_bus.dropped;
+    BubbleFeedback feedback = app->feedback;
+    uint32_t rate_steps = app->rate.body_steps;
+    uint32_t rate_frames = app->rate.body_frames;
+    uint32_t rate_skipped = app->rate.skipped_pairs;
 
-    // 4) Selected group: subtle extra ring for visibility
-    if(selected) {
-        canvas_draw_circle(canvas, x, y, r + 1);
+    app->bench_frames = sc->frames;
+    app->bench_running = sc->name;
+
+    bool running = true;
+    uint32_t start_ms = furi_get_tick();
+    for(uint32_t f = 0; f < sc->frames && running; f++) {
+        app->bench_frame = f;
+        bench_inputs(app, sc, f, res, &running);
+
+        bubble_app_step(app, sc->dt);
+        fizz_update(&app->fizz);
+        res->fizz_update_cycles += app->fizz.update_cycles;
+        water_update(&app->water, app->bodies, app->body_count);
+        res->water_update_cycles += app->water.update_cycles;
+        if(sc->queries) bench_queries(app, sc, &query_rng, res);
+        uint32_t cycles = app->perf.step_cycles;
+        res->step_cycles += cycles;
+        for(int l = 0; bubble_layered(app) && l < app->layer_count; l++) {
+            res->layer_cycles[l] += app->layers[l].step_cycles;
+        }
+        if(app->stick.chance_pct) {
+            size_t bucket = stick_bucket(app->stick.largest);
+            res->stick_cycles += app->stick.cycles;
+            res->stick_bucket_cycles[bucket] += cycles;
+            res->stick_bucket_frames[bucket]++;
+            if(app->stick.largest > res->stick_largest) res->stick_largest = app->stick.largest;
+        }
+        if(app->foam.on) {
+            res->foam_cycles += app->foam.cycles;
+            if(app->foam.cycles > res->foam_max) res->foam_max = app->foam.cycles;
+            res->foam_members += (uint32_t)__builtin_popcountll(app->foam.members);
+            res->foam_asleep += (uint32_t)__builtin_popcountll(app->foam.asleep);
+        }
+        if(cycles > res->step_max) res->step_max = cycles;
+        if(app->perf.blast_cycles > res->blast_max) res->blast_max = app->perf.blast_cycles;
+        res->bus_cycles += app->perf.bus_cycles;
+        if(app->perf.bus_cycles > res->bus_max) res->bus_max = app->perf.bus_cycles;
+        if(app->cursor.active) {
+            res->cursor_frames++;
+            res->cursor_cycles += app->cursor.cycles;
+            if(app->cursor.cycles > res->cursor_max) res->cursor_max = app->cursor.cycles;
+        }
+        if(app->render_mode == RenderModeAhead) {
+            bubble_render_ahead(app);
+            res->raster_cycles += app->perf.raster_cycles;
+            res->fizz_draw_cycles += app->fizz.draw_cycles;
+            res->water_draw_cycles += app->water.draw_cycles;
+            if(app->perf.raster_cycles > res->raster_max) res->raster_max = app->perf.raster_cycles;
+        }
+        if(app->rec.mode != RecModeOff) {
+            bubble_rec_frame(app);
+        }
+        res->frames++;
+
+        uint32_t us = cycles / furi_hal_cortex_instructions_per_microsecond() / 2;
+        res->hist[us < BENCH_HIST_BUCKETS ? us : BENCH_HIST_BUCKETS - 1]++;
+
+        if(f % BENCH_PROGRESS_FRAMES == 0) {
+            view_port_update(app->view_port);
+            if(bench_user_abort(app)) {
+                res->user_abort = true;
+                running = false;
+            }
+        }
+    }
+    res->wall_ms = furi_get_tick() - start_ms;
+    res->events_dropped = sim_bus.dropped - dropped;
+    res->feedback_requests = app->feedback.requests - feedback.requests;
+    res->feedback_merged = app->feedback.merged - feedback.merged;
+    res->feedback_dropped = app->feedback.dropped - feedback.dropped;
+    res->rate_body_steps = app->rate.body_steps - rate_steps;
+    res->rate_body_frames = app->rate.body_frames - rate_frames;
+    res->rate_skipped_pairs = app->rate.skipped_pairs - rate_skipped;
+    for(uint8_t i = 0; i < sc->subscribers; i++) {
+        sim_bus_unsubscribe(&sim_bus, bench_count_event, i ? spare_counts[i] : res->events);
     }
+    res->aborted = !running;
+    bench_stats_add(&res->carried, &app->stats);
+
+    app->bench_running = NULL;
 }
 
-static void bubble_draw(Canvas* canvas, void* ctx) {
-    BubbleApp* app = ctx;
-    canvas_clear(canvas);
+static uint32_t bench_percentile_us(const BenchResult* res, uint32_t pct) {
+    uint32_t want = res->frames * pct / 100;
+    uint32_t seen = 0;
+    for(uint32_t i = 0; i < BENCH_HIST_BUCKETS; i++) {
+        seen += res->hist[i];
+        if(seen > want) return i * 2;
+    }
+    return (BENCH_HIST_BUCKETS - 1) * 2;
+}
 
-    // Draw bodies only
+// FNV-1a over the final body states at 1/16 px: equal seeds and builds give
+// equal checksums, so a changed number means the simulation changed
+static uint32_t bench_checksum(const BubbleApp* app) {
+    uint32_t hash = 2166136261u;
     for(size_t i = 0; i < app->body_count; i++) {
         const PhysicsBody* b = &app->bodies[i];
-
-        // If we're popped but waiting for respawn, don't draw bubble body
-        if(b->popped && b->pop_anim_timer <= 0) {
-            continue;
+        int32_t v[3] = {
+            (int32_t)floorf(b->x * 16.0f), (int32_t)floorf(b->y * 16.0f), b->popped};
+        for(size_t k = 0; k < 3; k++) {
+            hash = (hash ^ (uint32_t)v[k]) * 16777619u;
         }
+    }
+    return hash;
+}
 
-        bool selected = app->hud_visible && (b->group == app->selected_group);
+// printf onto the end of a report line, stopping quietly once it is full
+static void bench_append(char* buf, size_t size, size_t* len, const char* fmt, ...) {
+    if(*len + 1 >= size) return;
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(buf + *len, size - *len, fmt, args);
+    va_end(args);
+    if(n > 0) *len = *len + (size_t)n < size ? *len + (size_t)n : size - 1;
+}
 
-        if(b->popped && b->pop_anim_timer > 0) {
-            bubble_draw_pop(canvas, b);
-        } else {
-            bubble_draw_body(canvas, b, selected);
+static void bench_report(const BubbleApp* app, const BenchScenario* sc, BenchResult* res, int bad) {
+    char* buf = res->line;
+    size_t len = 0;
+    size_t room = sizeof(res->line) - 1; // the newline always fits
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
+
+    if(bad) {
+        bench_append(buf, room, &len, "bench scenario=%s error=line%d", sc->name, bad);
+    } else {
+        const PhysicsStats* st = &res->carried;
+        uint32_t collisions = 0;
+        uint32_t pops = 0;
+        uint32_t respawns = 0;
+        for(int g = 0; g < GROUP_COUNT; g++) {
+            collisions += st->collisions[g];
+            pops += st->pops[g];
+            respawns += st->respawns_top[g] + st->respawns_popped[g];
+        }
+        uint32_t frames = res->frames ? res->frames : 1;
+        bench_append(
+            buf,
+            room,
+            &len,
+            "bench scenario=%s frames=%lu aborted=%d seed=%lu physics=%s broadphase=%s render=%s "
+            "compare=%d step_avg_us=%lu step_p50_us=%lu step_p99_us=%lu step_max_us=%lu "
+            "raster_avg_us=%lu inputs=%lu input_max_us=%lu wall_ms=%lu stack_free=%lu "
+            "collisions=%lu pops=%lu respawns=%lu pair_tests=%lu blast=%d chain=%d%% blast_avg_us=%lu blast_max_us=%lu "
+            "blast_queries=%lu chain_pops=%lu checksum=%08lx",
+            sc->name,
+            (unsigned long)res->frames,
+            res->aborted,
+            (unsigned long)sc->seed,
+            physics_mode_names[sc->physics],
+            broadphase_settings[sc->broad].name,
+            render_mode_names[sc->render],
+            sc->compare,
+            (unsigned long)(res->step_cycles / frames / cpu),
+            (unsigned long)bench_percentile_us(res, 50),
+            (unsigned long)bench_percentile_us(res, 99),
+            (unsigned long)(res->step_max / cpu),
+            (unsigned long)(res->raster_cycles / frames / cpu),
+            (unsigned long)res->inputs,
+            (unsigned long)(res->input_max / cpu),
+            (unsigned long)res->wall_ms,
+            (unsigned long)furi_thread_get_stack_space(furi_thread_get_current_id()),
+            (unsigned long)collisions,
+            (unsigned long)pops,
+            (unsigned long)respawns,
+            (unsigned long)st->pair_tests,
+            (int)sc->blast.radius,
+            (int)(sc->blast.chain_chance * 100.0f + 0.5f),
+            (unsigned long)(st->blast_cycles / frames / cpu),
+            (unsigned long)(res->blast_max / cpu),
+            (unsigned long)st->blast_queries,
+            (unsigned long)st->chain_pops,
+            (unsigned long)bench_checksum(app));
+
+        if(sc->fizz) {
+            uint32_t update = (uint32_t)(res->fizz_update_cycles / frames);
+            uint32_t draw = (uint32_t)(res->fizz_draw_cycles / frames);
+            bench_append(
+                buf,
+                room,
+                &len,
+                " fizz=%u fizz_update_per_ms=%lu fizz_draw_per_ms=%lu",
+                (unsigned)app->fizz.count,
+                (unsigned long)fizz_per_ms(&app->fizz, update),
+                (unsigned long)fizz_per_ms(&app->fizz, draw));
         }
-    }
-
-    // Footer: show which field is being edited + value (only if HUD visible)
-    if(app->hud_visible) {
-        BubbleGroupConfig* cfg = &app->groups[app->selected_group];
 
-        canvas_set_font(canvas, FontSecondary);
-        char buf[32];
+        if(sc->water) {
+            // Average cycles per frame and their share of the frame budget
+            uint32_t update = (uint32_t)(res->water_update_cycles / frames);
+            uint32_t draw = (uint32_t)(res->water_draw_cycles / frames);
+            bench_append(
+                buf,
+                room,
+                &len,
+                " water=on splashes=%lu water_update_cycles=%lu water_draw_cycles=%lu "
+                "water_budget_ppm=%lu",
+                (unsigned long)app->water.splashes,
+                (unsigned long)update,
+                (unsigned long)draw,
+                (unsigned long)water_budget_ppm(update + draw));
+        }
 
-        switch(app->menu_field) {
-            case ConfigFieldCount:
-                snprintf(buf, sizeof(buf), "Count=%d", cfg->count);
-                break;
-            case ConfigFieldRadius:
-                snprintf(buf, sizeof(buf), "Radius=%.1f", (double)cfg->radius);
-                break;
-            case ConfigFieldSpeed:
-                snprintf(buf, sizeof(buf), "Speed=%.2f", (double)cfg->rise_speed);
-                break;
-            case ConfigFieldRestitution: {
-                int res = (int)(cfg->restitution * 100.0f + 0.5f); // round to nearest int
-                snprintf(buf, sizeof(buf), "Bounce=%d%%", res);
-                break;
-            }
-            case ConfigFieldPopChance: {
-                int pct = (int)(cfg->pop_chance * 100.0f + 0.5f); // round to nearest int
-                snprintf(buf, sizeof(buf), "Pop=%d%%", pct);
-                break;
+        if(sc->layers > 1 && !sc->compare) {
+            // Step time per layer, front first
+            bench_append(buf, room, &len, " layers=%u layer_step_us=", (unsigned)sc->layers);
+            for(int l = 0; l < sc->layers; l++) {
+                bench_append(
+                    buf,
+                    room,
+                    &len,
+                    "%s%lu",
+                    l ? "/" : "",
+                    (unsigned long)(res->layer_cycles[l] / frames / cpu));
             }
-            default:
-                snprintf(buf, sizeof(buf), "?");
-                break;
         }
 
-        // bottom line: y = SCREEN_H - 1
-        canvas_draw_str(canvas, 0, SCREEN_H - 1, buf);
-    }
-}
+        if(sc->foam) {
+            // Average members and sleepers per frame, and the foam pass
+            bench_append(
+                buf,
+                room,
+                &len,
+                " foam=%s foam_members=%lu foam_asleep=%lu foam_avg_us=%lu foam_max_us=%lu",
+                bench_foam_names[sc->foam],
+                (unsigned long)(res->foam_members / frames),
+                (unsigned long)(res->foam_asleep / frames),
+                (unsigned long)(res->foam_cycles / frames / cpu),
+                (unsigned long)(res->foam_max / cpu));
+        }
 
-// --- Input handling ---------------------------------------------------------
+        if(sc->stick) {
+            // Step time by the size of the largest cluster, '-' where none ran
+            bench_append(
+                buf,
+                room,
+                &len,
+                " stick=%u%% edges=%u clusters=%u largest_max=%u pool_full=%lu stick_avg_us=%lu "
+                "stick_step_us=",
+                (unsigned)sc->stick,
+                (unsigned)app->stick.edge_count,
+                (unsigned)app->stick.clusters,
+                (unsigned)res->stick_largest,
+                (unsigned long)app->stick.pool_full,
+                (unsigned long)(res->stick_cycles / frames / cpu));
+            for(size_t b = 0; b < STICK_BUCKETS; b++) {
+                const char* sep = b ? "/" : "";
+                if(res->stick_bucket_frames[b]) {
+                    bench_append(
+                        buf,
+                        room,
+                        &len,
+                        "%s%lu",
+                        sep,
+                        (unsigned long)(res->stick_bucket_cycles[b] /
+                                        res->stick_bucket_frames[b] / cpu));
+                } else {
+                    bench_append(buf, room, &len, "%s-", sep);
+                }
+            }
+        }
 
-static void bubble_input_cb(InputEvent* input, void* ctx) {
-    BubbleApp* app = ctx;
-    BubbleEvent ev = {.type = EventTypeInput, .input = *input};
-    furi_message_queue_put(app->queue, &ev, 0);
-}
+        if(sc->render == RenderModeAhead) {
+            bench_append(
+                buf,
+                room,
+                &len,
+                " style=%s overdraw=%u raster_max_us=%lu raster_budget_us=%u",
+                render_style_names[sc->style],
+                (unsigned)(sc->overdraw ? sc->overdraw : 1),
+                (unsigned long)(res->raster_max / cpu),
+                (unsigned)sched_task_info[SchedTaskRender].budget_us);
+        }
 
-static void bubble_save_and_reinit(BubbleApp* app) {
-    bubble_app_reinit_group(app, app->selected_group);
-    bubble_save_config(app);
+        if(sc->subscribers) {
+            bench_append(
+                buf,
+                room,
+                &len,
+                " subscribers=%u bus_avg_us=%lu bus_max_us=%lu ev_pop=%lu ev_contact=%lu "
+                "ev_respawn=%lu ev_wall=%lu ev_dropped=%lu",
+                (unsigned)sc->subscribers,
+                (unsigned long)(res->bus_cycles / frames / cpu),
+                (unsigned long)(res->bus_max / cpu),
+                (unsigned long)res->events[SimEventPop],
+                (unsigned long)res->events[SimEventContact],
+                (unsigned long)res->events[SimEventRespawn],
+                (unsigned long)res->events[SimEventWall],
+                (unsigned long)res->events_dropped);
+        }
+        if(res->rate_body_frames) {
+            bench_append(
+                buf,
+                room,
+                &len,
+                " rate_steps=%lu rate_body_frames=%lu rate_skipped_pairs=%lu",
+                (unsigned long)res->rate_body_steps,
+                (unsigned long)res->rate_body_frames,
+                (unsigned long)res->rate_skipped_pairs);
+        }
+        if(sc->feedback != FeedbackModeOff) {
+            bench_append(
+                buf,
+                room,
+                &len,
+                " feedback=%s feedback_requests=%lu feedback_merged=%lu feedback_dropped=%lu",
+                feedback_mode_names[sc->feedback],
+                (unsigned long)res->feedback_requests,
+                (unsigned long)res->feedback_merged,
+                (unsigned long)res->feedback_dropped);
+        }
+        if(res->cursor_frames) {
+            bench_append(
+                buf,
+                room,
+                &len,
+                " cursor_frames=%lu cursor_avg_us=%lu cursor_max_us=%lu",
+                (unsigned long)res->cursor_frames,
+                (unsigned long)(res->cursor_cycles / res->cursor_frames / cpu),
+                (unsigned long)(res->cursor_max / cpu));
+        }
+        if(sc->queries) {
+            // cycles rather than us: a query is a few hundred of them
+            uint32_t q = res->query_count ? res->query_count : 1;
+            bench_append(
+                buf,
+                room,
+                &len,
+                " bodies=%lu queries=%u index_cyc=%lu rect_cyc=%lu circle_cyc=%lu nearest_cyc=%lu "
+                "ray_cyc=%lu",
+                (unsigned long)app->body_count,
+                (unsigned)sc->queries,
+                (unsigned long)(res->index_cycles / frames),
+                (unsigned long)(res->query_cycles[0] / q),
+                (unsigned long)(res->query_cycles[1] / q),
+                (unsigned long)(res->query_cycles[2] / q),
+                (unsigned long)(res->query_cycles[3] / q));
+        }
+    }
+    buf[len++] = '\n';
+    buf[len] = '\0';
+    FURI_LOG_I(TAG, "%s", buf);
+
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    storage_common_mkdir(storage, APP_DATA_PATH(""));
+    File* file = storage_file_alloc(storage);
+    if(storage_file_open(file, BUBBLE_BENCH_PATH, FSAM_WRITE, FSOM_OPEN_APPEND)) {
+        storage_file_write(file, buf, strlen(buf));
+        storage_file_sync(file);
+    }
+    storage_file_close(file);
+    storage_file_free(file);
+    furi_record_close(RECORD_STORAGE);
 }
 
-static void bubble_adjust_field(BubbleApp* app, int dir) {
-    BubbleGroupConfig* cfg = &app->groups[app->selected_group];
+// Run one scenario file and report it; false if the user aborted
+static bool bench_run_file(BubbleApp* app, const char* path, const char* name) {
+    BenchScenario* sc = malloc(sizeof(BenchScenario));
+    BenchResult* res = malloc(sizeof(BenchResult));
+    furi_check(sc && res);
 
-    switch(app->menu_field) {
-        case ConfigFieldCount:
-            cfg->count += dir;
-            if(cfg->count < 0) cfg->count = 0;
-            if(cfg->count > BUBBLE_MAX_COUNT) cfg->count = BUBBLE_MAX_COUNT;
-            bubble_save_and_reinit(app);
-            break;
+    int bad = bench_load(sc, path, name);
+    if(!bad) bench_run(app, sc, res);
+    bench_report(app, sc, res, bad);
+    bool aborted = !bad && res->user_abort;
 
-        case ConfigFieldRadius:
-            cfg->radius += (float)dir * 0.25f;
-            if(cfg->radius < BUBBLE_MIN_RADIUS) cfg->radius = BUBBLE_MIN_RADIUS;
-            if(cfg->radius > BUBBLE_MAX_RADIUS) cfg->radius = BUBBLE_MAX_RADIUS;
-            bubble_save_and_reinit(app);
-            break;
+    free(res);
+    free(sc);
+    return !aborted;
+}
 
-        case ConfigFieldSpeed:
-            cfg->rise_speed += (float)dir * 1.0f;
-            if(cfg->rise_speed < BUBBLE_MIN_SPEED) cfg->rise_speed = BUBBLE_MIN_SPEED;
-            if(cfg->rise_speed > BUBBLE_MAX_SPEED) cfg->rise_speed = BUBBLE_MAX_SPEED;
-            bubble_save_and_reinit(app);
-            break;
+// List the bundled scenarios, sorted so "all" always runs them in one order
+static void bench_list_files(BubbleApp* app) {
+    app->bench_file_count = 0;
+    Storage* storage = furi_record_open(RECORD_STORAGE);
+    File* dir = storage_file_alloc(storage);
+
+    if(storage_dir_open(dir, BUBBLE_BENCH_DIR)) {
+        FileInfo info;
+        char name[64];
+        while(app->bench_file_count < BENCH_MAX_FILES &&
+              storage_dir_read(dir, &info, name, sizeof(name))) {
+            size_t len = strlen(name);
+            if(file_info_is_dir(&info) || len < 5 || len - 4 >= BENCH_NAME_LEN ||
+               strcmp(name + len - 4, ".scn") != 0) {
+                continue;
+            }
+            name[len - 4] = '\0';
 
-        case ConfigFieldRestitution:
-            cfg->restitution += (float)dir * 0.01f;
-            if(cfg->restitution < BUBBLE_MIN_RESTITUTION) cfg->restitution = BUBBLE_MIN_RESTITUTION;
-            if(cfg->restitution > BUBBLE_MAX_RESTITUTION) cfg->restitution = BUBBLE_MAX_RESTITUTION;
-            bubble_save_and_reinit(app);
-            break;
+            size_t at = app->bench_file_count++;
+            while(at > 0 && strcmp(app->bench_files[at - 1], name) > 0) {
+                memcpy(app->bench_files[at], app->bench_files[at - 1], BENCH_NAME_LEN);
+                at--;
+            }
+            strcpy(app->bench_files[at], name);
+        }
+    }
 
-        case ConfigFieldPopChance:
-            cfg->pop_chance += (float)dir * 0.01f;
-            if(cfg->pop_chance < BUBBLE_MIN_POP) cfg->pop_chance = BUBBLE_MIN_POP;
-            if(cfg->pop_chance > BUBBLE_MAX_POP) cfg->pop_chance = BUBBLE_MAX_POP;
-            bubble_save_and_reinit(app);
-            break;
+    storage_dir_close(dir);
+    storage_file_free(dir);
+    furi_record_close(RECORD_STORAGE);
+}
 
-        default:
-            break;
+// Selection 0 runs every bundled scenario, n runs bench_files[n - 1]; the
+// user's settings and bodies are put back afterwards
+static void bench_run_selected(BubbleApp* app) {
+    BenchSaved saved;
+    bench_save_settings(app, &saved);
+
+    char path[96];
+    for(size_t i = 0; i < app->bench_file_count; i++) {
+        if(app->bench_selected && app->bench_selected != i + 1) continue;
+        snprintf(path, sizeof(path), "%s/%s.scn", BUBBLE_BENCH_DIR, app->bench_files[i]);
+        if(!bench_run_file(app, path, app->bench_files[i])) break;
     }
+
+    bench_restore_settings(app, &saved);
 }
 
-static void bubble_handle_input(BubbleApp* app, InputEvent* in, bool* running) {
-    // First, handle long-press OK to toggle HUD visibility
-    if((in->type == InputTypeLong) && (in->key == InputKeyOk)) {
-        app->hud_visible = !app->hud_visible;
+// Launch argument: "all" or the path of a scenario file, e.g.
+//   loader open "Bubble Sim" /ext/apps_data/bubble_sim/mine.scn
+static void bench_run_arg(BubbleApp* app, const char* arg) {
+    if(strcmp(arg, "all") == 0) {
+        app->bench_selected = 0;
+        bench_run_selected(app);
         return;
     }
 
-    // For everything else, we only care about short/repeat events
-    if(!(in->type == InputTypeShort || in->type == InputTypeRepeat)) return;
+    BenchSaved saved;
+    bench_save_settings(app, &saved);
+    const char* name = strrchr(arg, '/');
+    bench_run_file(app, arg, name ? name + 1 : arg);
+    bench_restore_settings(app, &saved);
+}
 
-    switch(in->key) {
-        case InputKeyBack:
-            // Back now exits immediately
-            *running = false;
-            return;
+// --- Main loop tasks --------------------------------------------------------
 
-        case InputKeyUp:
-            // Change which property is selected
-            if(app->menu_field == 0) {
-                app->menu_field = (ConfigField)(ConfigFieldCountEnum - 1);
-            } else {
-                app->menu_field = (ConfigField)(app->menu_field - 1);
-            }
-            break;
+static bool sched_task_input(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(task);
+    BubbleEvent ev;
+    if(furi_message_queue_get(app->queue, &ev, 0) == FuriStatusOk) {
+        bubble_handle_input(app, &ev.input, running);
+    }
+    return true;
+}
 
-        case InputKeyDown:
-            // Change which property is selected
-            app->menu_field = (ConfigField)(app->menu_field + 1);
-            if(app->menu_field >= ConfigFieldCountEnum) {
-                app->menu_field = ConfigFieldCount;
-            }
-            break;
+static bool sched_task_physics(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(task);
+    UNUSED(running);
+    bubble_app_step(app, SCHED_FRAME_MS / 1000.0f);
+    fizz_update(&app->fizz);
+    water_update(&app->water, app->bodies, app->body_count);
+    return true;
+}
 
-        case InputKeyLeft:
-            // Decrease value of current property
-            bubble_adjust_field(app, -1);
-            break;
+static bool sched_task_render(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(task);
+    UNUSED(running);
+    if(app->render_mode == RenderModeAhead) bubble_render_ahead(app);
+    return true;
+}
 
-        case InputKeyRight:
-            // Increase value of current property
-            bubble_adjust_field(app, +1);
-            break;
+// Frames go into the RAM buffer here; the SD write is left to the sd task
+static bool sched_task_record(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(task);
+    UNUSED(running);
+    if(app->rec.mode == RecModeOff) return true;
+    bubble_rec_frame(app);
+    if(app->rec.used >= REC_BUF_SIZE / 2) sched_wake(&app->sched, SchedTaskFlush);
+    return true;
+}
 
-        case InputKeyOk:
-            // Cycle group (Small -> Medium -> Large -> Small ...)
-            app->selected_group++;
-            if(app->selected_group >= GROUP_COUNT) {
-                app->selected_group = 0;
-            }
-            break;
+static bool sched_task_flush(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(task);
+    UNUSED(running);
+    bubble_rec_flush(&app->rec);
+    return true;
+}
 
-        default:
-            break;
+// Woken by an edit; waits for the edits to stop so a held key saves once
+static bool sched_task_config(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(task);
+    UNUSED(running);
+    if(app->sched.frame - app->config_changed < CONFIG_SAVE_FRAMES) return false;
+    bubble_persist_config(app);
+    return true;
+}
+
+// One log line per frame: the session line, then a line per group
+static bool sched_task_stats(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(running);
+    char buf[320];
+    if(task->step == 0) {
+        bubble_format_session_stats(app, buf, sizeof(buf));
+    } else {
+        bubble_format_group_stats(app, task->step - 1, buf, sizeof(buf));
     }
+    FURI_LOG_I(TAG, "%s", buf);
+    if(task->step++ < GROUP_COUNT) return false;
+    task->step = 0;
+    return true;
+}
+
+// Woken at startup and by edits while Broad is on Auto
+static bool sched_task_tune(BubbleApp* app, SchedTask* task, bool* running) {
+    UNUSED(task);
+    UNUSED(running);
+    return bubble_tune_step(app);
 }
 
+static const SchedTaskFn sched_task_fns[SchedTaskCountEnum] = {
+    [SchedTaskInput] = sched_task_input,
+    [SchedTaskPhysics] = sched_task_physics,
+    [SchedTaskRender] = sched_task_render,
+    [SchedTaskRecord] = sched_task_record,
+    [SchedTaskFlush] = sched_task_flush,
+    [SchedTaskConfig] = sched_task_config,
+    [SchedTaskStats] = sched_task_stats,
+    [SchedTaskTune] = sched_task_tune,
+};
+
 // --- Entry ------------------------------------------------------------------
 
+// p: optional launch argument, "all" or a scenario path runs benchmarks and
+// exits (see the Benchmark scenarios section)
 int32_t bubble_sim_app(void* p) {
-    UNUSED(p);
+    const char* args = p;
 
     BubbleApp* app = malloc(sizeof(BubbleApp));
     furi_check(app);
@@ -798,14 +7218,46 @@ int32_t bubble_sim_app(void* p) {
     app->gravity_y = 0.0f; // no gravity; bubbles just rise by initial velocity
 
     // Defaults, then load from disk if present
-    bubble_app_init_groups(app);
-    bubble_load_config(app);
+    bubble_init_default_groups(app->groups);
+    bubble_load_config(app->groups, BUBBLE_CFG_PATH);
+
+    // World B of compare mode starts as a copy of A unless it was saved
+    memcpy(app->groups_b, app->groups, sizeof(app->groups_b));
+    bubble_load_config(app->groups_b, BUBBLE_CFG_B_PATH);
 
     app->selected_group = 0;
     app->menu_field = ConfigFieldCount;
-    app->hud_visible = true; // HUD visible by default
+    app->hud_page = HudPageConfig; // HUD visible by default
+    app->physics_mode = PhysicsModeStep;
+    app->layer_count = 1;
+    app->foam.sleep = true;
+    stick_reset(&app->stick);
+    app->broad_setting = 0; // Naive until the tuner has picked
+    app->broad_auto = true;
+    bubble_apply_broadphase(app);
+    app->cursor.x = SCREEN_W / 2;
+    app->cursor.y = SCREEN_H / 2;
+    memset(&sim_bus, 0, sizeof(sim_bus));
+    sim_bus.base = app->bodies;
+
+    fb_span_init();
+    app->packed_selftest_ok = pk_selftest(&app->packed_checksum);
+    FURI_LOG_I(
+        TAG,
+        "packed kernels (%s): %s, checksum %08lx",
+        PK_HAVE_DSP ? "dsp" : "emu",
+        app->packed_selftest_ok ? "match" : "MISMATCH",
+        (unsigned long)app->packed_checksum);
 
     bubble_app_build_bodies(app);
+    bench_list_files(app);
+
+#ifdef BUBBLE_PROFILER
+    prof_start();
+#endif
+
+    app->render.mutex = furi_mutex_alloc(FuriMutexTypeNormal);
+    furi_check(app->render.mutex);
 
     // Flipper GUI plumbing
     app->gui = furi_record_open(RECORD_GUI);
@@ -816,50 +7268,55 @@ int32_t bubble_sim_app(void* p) {
 
     app->queue = furi_message_queue_alloc(8, sizeof(BubbleEvent));
     furi_check(app->queue);
+    sched_init(&app->sched);
+    sched_wake(&app->sched, SchedTaskTune);
+    bubble_feedback_start(&app->feedback);
 
     view_port_draw_callback_set(app->view_port, bubble_draw, app);
     view_port_input_callback_set(app->view_port, bubble_input_cb, app);
     gui_add_view_port(app->gui, app->view_port, GuiLayerFullscreen);
 
     bool running = true;
-    BubbleEvent ev;
-
-    while(running) {
-        // Handle inputs
-        if(furi_message_queue_get(app->queue, &ev, 0) == FuriStatusOk) {
-            bubble_handle_input(app, &ev.input, &running);
-        }
+    uint32_t cpu = furi_hal_cortex_instructions_per_microsecond();
 
-        // Physics step
-        const float dt = 0.03f; // ~30 ms
-        physics_step(app->bodies, app->body_count, dt, app->gravity_y, &app->bounds, &app->rng);
+    if(args && *args) {
+        bench_run_arg(app, args);
+        running = false;
+    }
 
-        // Handle popped bubbles: respawn them only after pop animation finishes
-        for(size_t i = 0; i < app->body_count; i++) {
-            PhysicsBody* b = &app->bodies[i];
-            if(b->popped && b->pop_anim_timer <= 0) {
-                bubble_respawn_body(app, b);
-            }
+    while(running) {
+        // OK on the Bench field; a run takes over the loop until it finishes
+        if(app->bench_request) {
+            app->bench_request = false;
+            bench_run_selected(app);
         }
 
-        // If a bubble floats off the top, respawn well below the screen
-        for(size_t i = 0; i < app->body_count; i++) {
-            PhysicsBody* b = &app->bodies[i];
-            if(!b->popped && b->pop_anim_timer <= 0 &&
-               (b->y + b->radius < app->bounds.min_y - 20.0f)) {
-                bubble_respawn_body(app, b);
-            }
-        }
+        sched_run_frame(&app->sched, sched_task_fns, app, &running);
 
         view_port_update(app->view_port);
-        furi_delay_ms(30);
+        uint32_t busy_ms = app->sched.frame_cycles / cpu / 1000;
+        furi_delay_ms(busy_ms < SCHED_FRAME_MS ? SCHED_FRAME_MS - busy_ms : 1);
     }
 
+    bubble_persist_config(app);
+    bubble_tune_cancel(app);
+    bubble_rec_stop(&app->rec);
+    bubble_log_stats(app);
+    if(!(args && *args)) bubble_save_stats(app); // benchmarks wrote bench.txt
+    bubble_feedback_stop(&app->feedback);
+
     gui_remove_view_port(app->gui, app->view_port);
+    fizz_free(&app->fizz); // Direct mode draws the fizz from the draw callback
+
+#ifdef BUBBLE_PROFILER
+    // Last, so the shutdown itself is in the profile too
+    prof_stop_and_save();
+#endif
     view_port_free(app->view_port);
     furi_record_close(RECORD_GUI);
 
     furi_message_queue_free(app->queue);
+    furi_mutex_free(app->render.mutex);
     free(app);
 
     return 0;
@@ -0,0 +1,341 @@
+// Host-side symbolizer for Bubble Sim profiles (profile.bin).
+//
+//   cc -O2 -o bubble_prof tools/bubble_prof.c
+//   bubble_prof [-f firmware.elf] app.elf profile.bin > profile.folded
+//   flamegraph.pl profile.folded > profile.svg
+//
+// app.elf is the unstripped app, dist/debug/bubble_sim_d.elf after a ufbt
+// build (the .fap works too if it kept its symbols).
+//
+// Each sample holds the PC and LR of the interrupted thread and the return
+// addresses the handler found on its stack. The .fap is loaded at a
+// different address every run, so the file records where bubble_sim_app
+// ended up and app symbols are placed relative to it. Firmware addresses
+// are absolute and need the matching firmware ELF (-f); without it they
+// fold into [firmware]. Frames are printed outermost first, one line per
+// distinct stack: "thread;outer;inner count".
+//
+// The PC is the exact leaf. Callers are the LR and the scanned words that
+// land inside a known function, innermost first; a stale word can add a
+// caller that wasn't live. Consecutive repeats of one function are merged.
+//
+// The format is defined in bubble_sim.c (Profile file format); the structs
+// below must stay in sync with it.
+
+#define _DEFAULT_SOURCE // getopt under -std=c11
+#include <elf.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define PROF_MAGIC 0x46525042u
+#define PROF_VERSION 1
+#define PROF_REC_THREAD 'T'
+#define PROF_REC_SAMPLE 'S'
+#define PROF_THREAD_OTHER 0xFE
+#define PROF_THREAD_IRQ 0xFF
+#define PROF_FLASH_LO 0x08000000u
+#define PROF_FLASH_HI 0x08100000u
+#define MAX_STACK_WORDS 64
+#define MAX_FRAMES (2 + MAX_STACK_WORDS)
+#define ANCHOR "bubble_sim_app"
+#define UNSIZED_MAX 4096 // bytes an unsized symbol may cover
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t sample_hz;
+    uint32_t anchor;
+    uint16_t stack_words;
+    uint16_t reserved;
+} ProfFileHeader;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t index;
+    char name[14];
+} ProfThreadRecord;
+
+typedef struct __attribute__((packed)) {
+    uint8_t type;
+    uint8_t thread;
+    uint8_t words;
+    uint8_t reserved;
+    uint32_t pc;
+    uint32_t lr;
+} ProfSampleHead; // followed by stack_words uint32_t
+
+// --- Symbols ----------------------------------------------------------------
+
+typedef struct {
+    uint32_t lo;
+    uint32_t hi; // exclusive; 0 until sym_sort() sizes it
+    const char* name;
+} Symbol;
+
+typedef struct {
+    Symbol* syms;
+    size_t count;
+    size_t cap;
+} SymbolTable;
+
+static void sym_add(SymbolTable* t, uint32_t lo, uint32_t size, const char* name) {
+    if(t->count == t->cap) {
+        t->cap = t->cap ? t->cap * 2 : 1024;
+        t->syms = realloc(t->syms, t->cap * sizeof(Symbol));
+        if(!t->syms) exit(1);
+    }
+    t->syms[t->count++] = (Symbol){lo, size ? lo + size : 0, name};
+}
+
+static int sym_cmp(const void* a, const void* b) {
+    uint32_t x = ((const Symbol*)a)->lo, y = ((const Symbol*)b)->lo;
+    return x < y ? -1 : x > y;
+}
+
+static void sym_sort(SymbolTable* t) {
+    qsort(t->syms, t->count, sizeof(Symbol), sym_cmp);
+    // Unsized symbols (hand-written assembly) run to the next one, capped so
+    // the last one in a region doesn't swallow the gap to the next region
+    for(size_t i = 0; i < t->count; i++) {
+        Symbol* s = &t->syms[i];
+        if(s->hi) continue;
+        s->hi = s->lo + UNSIZED_MAX;
+        if(i + 1 < t->count && t->syms[i + 1].lo < s->hi) s->hi = t->syms[i + 1].lo;
+    }
+}
+
+static const char* sym_find(const SymbolTable* t, uint32_t addr) {
+    size_t lo = 0, hi = t->count;
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(t->syms[mid].lo <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if(!lo) return NULL;
+    const Symbol* s = &t->syms[lo - 1];
+    return addr < s->hi ? s->name : NULL;
+}
+
+static uint8_t* read_file(const char* path, size_t* size) {
+    FILE* f = fopen(path, "rb");
+    if(!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    uint8_t* data = len > 0 ? malloc((size_t)len) : NULL;
+    if(data && fread(data, 1, (size_t)len, f) != (size_t)len) {
+        free(data);
+        data = NULL;
+    }
+    fclose(f);
+    *size = data ? (size_t)len : 0;
+    return data;
+}
+
+// Function symbols of a 32-bit ELF. With `anchor` set (the app), only
+// symbols in the anchor's section are kept, placed so that the anchor
+// lands at anchor_addr; otherwise values are taken as absolute. The file
+// stays loaded, the names point into it.
+static bool elf_load(SymbolTable* t, const char* path, const char* anchor, uint32_t anchor_addr) {
+    size_t size;
+    uint8_t* data = read_file(path, &size);
+    if(!data || size < sizeof(Elf32_Ehdr) || memcmp(data, ELFMAG, SELFMAG) != 0 ||
+       data[EI_CLASS] != ELFCLASS32) {
+        fprintf(stderr, "%s: not a 32-bit ELF\n", path);
+        return false;
+    }
+    const Elf32_Ehdr* eh = (const Elf32_Ehdr*)data;
+    if(eh->e_shoff + (size_t)eh->e_shnum * sizeof(Elf32_Shdr) > size) return false;
+    const Elf32_Shdr* sh = (const Elf32_Shdr*)(data + eh->e_shoff);
+
+    for(size_t s = 0; s < eh->e_shnum; s++) {
+        if(sh[s].sh_type != SHT_SYMTAB || sh[s].sh_link >= eh->e_shnum) continue;
+        const Elf32_Sym* syms = (const Elf32_Sym*)(data + sh[s].sh_offset);
+        size_t count = sh[s].sh_size / sizeof(Elf32_Sym);
+        const char* names = (const char*)(data + sh[sh[s].sh_link].sh_offset);
+
+        uint32_t base = 0;
+        uint16_t section = 0;
+        if(anchor) {
+            size_t i;
+            for(i = 0; i < count; i++) {
+                if(strcmp(names + syms[i].st_name, anchor) == 0) break;
+            }
+            if(i == count) {
+                fprintf(stderr, "%s: no %s symbol\n", path, anchor);
+                return false;
+            }
+            section = syms[i].st_shndx;
+            base = anchor_addr - (syms[i].st_value & ~1u);
+        }
+
+        size_t skipped = 0;
+        for(size_t i = 0; i < count; i++) {
+            const Elf32_Sym* sym = &syms[i];
+            if(ELF32_ST_TYPE(sym->st_info) != STT_FUNC || sym->st_shndx == SHN_UNDEF) continue;
+            if(anchor && sym->st_shndx != section) {
+                skipped++;
+                continue;
+            }
+            sym_add(t, base + (sym->st_value & ~1u), sym->st_size, names + sym->st_name);
+        }
+        if(skipped) {
+            fprintf(stderr, "%s: %zu functions outside the anchor's section\n", path, skipped);
+        }
+        return true;
+    }
+    fprintf(stderr, "%s: no symbol table\n", path);
+    return false;
+}
+
+// --- Folded stacks ----------------------------------------------------------
+
+typedef struct {
+    char* key;
+    uint32_t count;
+} FoldEntry;
+
+typedef struct {
+    FoldEntry* slots;
+    size_t cap; // power of two
+    size_t used;
+} FoldTable;
+
+static uint64_t fold_hash(const char* s) {
+    uint64_t h = 1469598103934665603ull;
+    while(*s) h = (h ^ (uint8_t)*s++) * 1099511628211ull;
+    return h;
+}
+
+static void fold_add(FoldTable* t, const char* key) {
+    if((t->used + 1) * 2 > t->cap) {
+        size_t cap = t->cap ? t->cap * 2 : 1024;
+        FoldTable grown = {calloc(cap, sizeof(FoldEntry)), cap, 0};
+        if(!grown.slots) exit(1);
+        for(size_t i = 0; i < t->cap; i++) {
+            if(!t->slots[i].key) continue;
+            size_t j = fold_hash(t->slots[i].key) & (grown.cap - 1);
+            while(grown.slots[j].key) j = (j + 1) & (grown.cap - 1);
+            grown.slots[j] = t->slots[i];
+            grown.used++;
+        }
+        free(t->slots);
+        *t = grown;
+    }
+    size_t j = fold_hash(key) & (t->cap - 1);
+    while(t->slots[j].key && strcmp(t->slots[j].key, key) != 0) j = (j + 1) & (t->cap - 1);
+    if(!t->slots[j].key) {
+        t->slots[j].key = strdup(key);
+        t->used++;
+    }
+    t->slots[j].count++;
+}
+
+static const char* frame_name(const SymbolTable* t, uint32_t addr) {
+    const char* name = sym_find(t, addr);
+    if(name) return name;
+    return addr >= PROF_FLASH_LO && addr < PROF_FLASH_HI ? "[firmware]" : "[unknown]";
+}
+
+// --- Main -------------------------------------------------------------------
+
+static int usage(void) {
+    fprintf(stderr, "usage: bubble_prof [-f firmware.elf] app.elf profile.bin\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    const char* firmware = NULL;
+    int opt;
+    while((opt = getopt(argc, argv, "f:")) != -1) {
+        if(opt != 'f') return usage();
+        firmware = optarg;
+    }
+    if(optind != argc - 2) return usage();
+    const char* app = argv[optind];
+    const char* profile = argv[optind + 1];
+
+    FILE* f = fopen(profile, "rb");
+    ProfFileHeader header;
+    if(!f || fread(&header, sizeof(header), 1, f) != 1 || header.magic != PROF_MAGIC ||
+       header.version != PROF_VERSION || header.header_size < sizeof(header) ||
+       header.stack_words > MAX_STACK_WORDS) {
+        fprintf(stderr, "%s: not a Bubble Sim profile\n", profile);
+        return 1;
+    }
+    fseek(f, header.header_size, SEEK_SET);
+
+    SymbolTable syms = {0};
+    if(!elf_load(&syms, app, ANCHOR, header.anchor)) return 1;
+    if(firmware && !elf_load(&syms, firmware, NULL, 0)) return 1;
+    sym_sort(&syms);
+
+    char threads[256][16];
+    for(int i = 0; i < 256; i++) snprintf(threads[i], sizeof(threads[i]), "thread%d", i);
+    snprintf(threads[PROF_THREAD_OTHER], sizeof(threads[0]), "[other]");
+    snprintf(threads[PROF_THREAD_IRQ], sizeof(threads[0]), "[interrupt]");
+
+    FoldTable folds = {0};
+    uint32_t samples = 0;
+    uint32_t stack[MAX_STACK_WORDS];
+    char line[MAX_FRAMES * 64];
+    int type;
+    while((type = fgetc(f)) != EOF) {
+        if(type == PROF_REC_THREAD) {
+            ProfThreadRecord rec;
+            if(fread(&rec.index, sizeof(rec) - 1, 1, f) != 1) break;
+            snprintf(threads[rec.index], sizeof(threads[0]), "%.14s", rec.name);
+            continue;
+        }
+        ProfSampleHead s;
+        if(type != PROF_REC_SAMPLE || fread(&s.thread, sizeof(s) - 1, 1, f) != 1 ||
+           fread(stack, sizeof(uint32_t), header.stack_words, f) != header.stack_words) {
+            break;
+        }
+        samples++;
+
+        // Innermost first: the PC, then callers from the LR and the scan
+        const char* frames[MAX_FRAMES];
+        size_t depth = 0;
+        if(s.thread != PROF_THREAD_IRQ) {
+            frames[depth++] = frame_name(&syms, s.pc & ~1u);
+            uint32_t callers[MAX_STACK_WORDS + 1];
+            size_t n = 0;
+            callers[n++] = s.lr;
+            for(uint8_t i = 0; i < s.words && i < header.stack_words; i++) callers[n++] = stack[i];
+            for(size_t i = 0; i < n; i++) {
+                if(!(callers[i] & 1u)) continue;
+                // A return address points after the call; look up the call itself
+                const char* name = sym_find(&syms, (callers[i] & ~1u) - 2);
+                if(name && strcmp(name, frames[depth - 1]) != 0) frames[depth++] = name;
+            }
+        }
+
+        size_t len = (size_t)snprintf(line, sizeof(line), "%s", threads[s.thread]);
+        while(depth && len < sizeof(line)) {
+            len += (size_t)snprintf(line + len, sizeof(line) - len, ";%s", frames[--depth]);
+        }
+        if(len < sizeof(line)) fold_add(&folds, line);
+    }
+    fclose(f);
+
+    for(size_t i = 0; i < folds.cap; i++) {
+        if(folds.slots[i].key) printf("%s %u\n", folds.slots[i].key, folds.slots[i].count);
+    }
+    fprintf(
+        stderr,
+        "%u samples at %u Hz, %zu stacks, %zu functions\n",
+        samples,
+        header.sample_hz,
+        folds.used,
+        syms.count);
+    return 0;
+}
@@ -0,0 +1,553 @@
+// Host-side analyzer for Bubble Sim recordings (rec.bsr).
+//
+//   cc -O2 -o bubble_trace tools/bubble_trace.c -lm
+//   bubble_trace [-f frame]... rec.bsr
+//
+// One streaming pass over the file: per-group statistics, frame diffs and
+// timing summaries, printed as key=value lines like stats.txt. The file is
+// mapped a window at a time and pages behind the cursor are dropped, so a
+// multi-GB soak recording is analyzed in constant memory. While it streams,
+// the pass keeps a sparse seek table (every stride-th frame, the stride
+// doubling whenever the table fills); -f then dumps single frames by
+// seeking to the nearest indexed frame and walking forward from there.
+//
+// The format is defined in bubble_sim.c (Recording file format); the structs
+// below must stay in sync with it.
+
+#define _DEFAULT_SOURCE // madvise, getopt under -std=c11
+#define _FILE_OFFSET_BITS 64
+#include <fcntl.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define REC_MAGIC 0x43525342u
+#define REC_VERSION 1
+#define REC_FRAME_SYNC 0xB5F7u
+#define REC_FRAME_SCREEN 0x01
+#define REC_BODY_POPPED 0x01
+#define REC_BODY_ANIMATING 0x02
+#define REC_BODY_COOLDOWN 0x04
+
+#define SCREEN_BYTES(h) ((size_t)(h)->screen_w * (h)->screen_h / 8)
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t screen_w;
+    uint16_t screen_h;
+    uint32_t cycles_per_us;
+} RecFileHeader;
+
+typedef struct __attribute__((packed)) {
+    uint16_t sync;
+    uint8_t flags;
+    uint8_t body_count;
+    uint32_t frame;
+    uint32_t tick_ms;
+    uint32_t step_cycles;
+    uint32_t raster_cycles;
+} RecFrameHeader;
+
+typedef struct __attribute__((packed)) {
+    int16_t x;
+    int16_t y;
+    uint8_t radius;
+    uint8_t group;
+    uint8_t flags;
+    uint8_t world;
+} RecBody;
+
+#define MAX_BODIES 255
+#define MAX_GROUPS 8
+#define MAX_SCREEN_BYTES 4096
+#define MAX_RECORD (sizeof(RecFrameHeader) + MAX_BODIES * sizeof(RecBody) + MAX_SCREEN_BYTES)
+#define WINDOW_SIZE ((size_t)256 << 20) // mapped at a time
+#define RELEASE_STEP ((uint64_t)16 << 20) // read pages dropped in chunks this big
+#define SEEK_SLOTS 4096
+#define HIST_US 20000 // 1 us buckets, slower frames land in the last one
+#define RESPAWN_JUMP (16 * 16) // 1/16 px: a downward jump this big is a respawn
+
+// --- Windowed mapping -------------------------------------------------------
+
+typedef struct {
+    int fd;
+    uint64_t size;
+    long page;
+    const uint8_t* base; // mapping of [start, start + len)
+    uint64_t start;
+    size_t len;
+    uint64_t released; // pages of the window before this are dropped
+} MappedFile;
+
+static bool map_open(MappedFile* m, const char* path) {
+    memset(m, 0, sizeof(*m));
+    m->fd = open(path, O_RDONLY);
+    if(m->fd < 0) return false;
+    struct stat st;
+    if(fstat(m->fd, &st) != 0) return false;
+    m->size = (uint64_t)st.st_size;
+    m->page = sysconf(_SC_PAGESIZE);
+    return true;
+}
+
+static void map_close(MappedFile* m) {
+    if(m->base) munmap((void*)m->base, m->len);
+    if(m->fd >= 0) close(m->fd);
+    m->base = NULL;
+}
+
+// Pointer to [off, off + need), remapping the window if it isn't covered.
+// NULL past the end of the file.
+static const uint8_t* map_at(MappedFile* m, uint64_t off, size_t need) {
+    if(off + need > m->size) return NULL;
+    if(m->base && off >= m->start && off + need <= m->start + m->len) {
+        return m->base + (off - m->start);
+    }
+
+    if(m->base) munmap((void*)m->base, m->len);
+    m->start = off - off % (uint64_t)m->page;
+    uint64_t len = m->size - m->start;
+    m->len = len < WINDOW_SIZE ? (size_t)len : WINDOW_SIZE;
+    void* p = mmap(NULL, m->len, PROT_READ, MAP_PRIVATE, m->fd, (off_t)m->start);
+    if(p == MAP_FAILED) {
+        m->base = NULL;
+        return NULL;
+    }
+    m->base = p;
+    m->released = m->start;
+    madvise(p, m->len, MADV_SEQUENTIAL);
+    return m->base + (off - m->start);
+}
+
+// Drop already-read pages of the window so RSS stays flat
+static void map_release_before(MappedFile* m, uint64_t off) {
+    if(!m->base || off < m->released + RELEASE_STEP) return;
+    uint64_t end = off - off % (uint64_t)m->page;
+    madvise((void*)(m->base + (m->released - m->start)), (size_t)(end - m->released), MADV_DONTNEED);
+    m->released = end;
+}
+
+// --- Frame parsing ----------------------------------------------------------
+
+typedef struct {
+    const RecFrameHeader* header;
+    const RecBody* bodies;
+    const uint8_t* screen; // NULL without REC_FRAME_SCREEN
+    size_t size;
+} Frame;
+
+static size_t frame_size(const RecFileHeader* fh, const RecFrameHeader* h) {
+    return sizeof(*h) + (size_t)h->body_count * sizeof(RecBody) +
+           ((h->flags & REC_FRAME_SCREEN) ? SCREEN_BYTES(fh) : 0);
+}
+
+// Frame at off, false at the end or on a torn record
+static bool frame_read(MappedFile* m, const RecFileHeader* fh, uint64_t off, Frame* f) {
+    const RecFrameHeader* h = (const RecFrameHeader*)map_at(m, off, sizeof(RecFrameHeader));
+    if(!h || h->sync != REC_FRAME_SYNC) return false;
+    size_t size = frame_size(fh, h);
+    const uint8_t* p = map_at(m, off, size);
+    if(!p) return false;
+    f->header = (const RecFrameHeader*)p;
+    f->bodies = (const RecBody*)(p + sizeof(RecFrameHeader));
+    f->screen = (f->header->flags & REC_FRAME_SCREEN) ?
+                    p + sizeof(RecFrameHeader) + f->header->body_count * sizeof(RecBody) :
+                    NULL;
+    f->size = size;
+    return true;
+}
+
+// Next offset after a bad record that starts a readable frame, or size
+static uint64_t frame_resync(MappedFile* m, const RecFileHeader* fh, uint64_t off) {
+    Frame f;
+    for(off++; off + sizeof(RecFrameHeader) <= m->size; off++) {
+        if(frame_read(m, fh, off, &f)) return off;
+    }
+    return m->size;
+}
+
+// --- Seek table -------------------------------------------------------------
+
+typedef struct {
+    uint64_t offset[SEEK_SLOTS];
+    uint32_t frame[SEEK_SLOTS];
+    size_t count;
+    uint32_t stride; // in frames seen, not frame numbers
+} SeekTable;
+
+static void seek_add(SeekTable* t, uint64_t seen, uint32_t frame, uint64_t offset) {
+    if(seen % t->stride) return;
+    if(t->count == SEEK_SLOTS) {
+        // Full: keep every other entry and index half as often
+        for(size_t i = 0; i < SEEK_SLOTS / 2; i++) {
+            t->offset[i] = t->offset[i * 2];
+            t->frame[i] = t->frame[i * 2];
+        }
+        t->count = SEEK_SLOTS / 2;
+        t->stride *= 2;
+        if(seen % t->stride) return;
+    }
+    t->offset[t->count] = offset;
+    t->frame[t->count] = frame;
+    t->count++;
+}
+
+// Offset of the last indexed frame numbered <= frame (recordings restart
+// numbering only when a new file is started, so numbers are increasing)
+static uint64_t seek_find(const SeekTable* t, uint32_t frame, uint64_t first) {
+    size_t lo = 0;
+    size_t hi = t->count;
+    while(lo < hi) {
+        size_t mid = (lo + hi) / 2;
+        if(t->frame[mid] <= frame) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo ? t->offset[lo - 1] : first;
+}
+
+// --- Statistics -------------------------------------------------------------
+
+typedef struct {
+    uint64_t body_frames;
+    uint64_t visible_frames;
+    uint64_t cooldown_frames;
+    uint64_t pops;
+    uint64_t respawns;
+    double travel; // px moved, respawn jumps excluded
+} GroupStats;
+
+typedef struct {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t resyncs;
+    uint64_t screens;
+    uint32_t first_tick;
+    uint32_t last_tick;
+    uint32_t first_frame;
+    uint32_t last_frame;
+
+    GroupStats groups[MAX_GROUPS];
+    int max_group;
+
+    // Frame diffs against the previous frame
+    uint64_t diff_frames;
+    double diff_sum; // mean body displacement per frame, px
+    double diff_max;
+    uint64_t count_changes;
+    uint64_t pixel_diff_frames;
+    uint64_t pixel_diff_sum; // changed screen pixels
+    uint32_t pixel_diff_max;
+
+    // Timing
+    uint32_t step_hist[HIST_US];
+    uint32_t raster_hist[HIST_US];
+    uint64_t raster_frames;
+    uint32_t interval_hist[HIST_US / 100]; // 1 ms buckets
+    uint64_t late_frames;                  // interval over 40 ms
+} TraceStats;
+
+static void hist_add(uint32_t* hist, size_t buckets, uint64_t v) {
+    hist[v < buckets ? v : buckets - 1]++;
+}
+
+static uint64_t hist_percentile(const uint32_t* hist, size_t buckets, uint64_t n, double p) {
+    uint64_t want = (uint64_t)((double)n * p);
+    uint64_t seen = 0;
+    for(size_t i = 0; i < buckets; i++) {
+        seen += hist[i];
+        if(seen > want) return i;
+    }
+    return buckets - 1;
+}
+
+static void hist_summary(
+    const char* name,
+    const uint32_t* hist,
+    size_t buckets,
+    uint64_t n,
+    const char* unit
+) {
+    if(!n) return;
+    double sum = 0.0;
+    uint64_t max = 0;
+    for(size_t i = 0; i < buckets; i++) {
+        sum += (double)i * hist[i];
+        if(hist[i]) max = i;
+    }
+    printf(
+        "timing %s_avg_%s=%.1f %s_p50_%s=%llu %s_p99_%s=%llu %s_max_%s=%llu%s\n",
+        name,
+        unit,
+        sum / (double)n,
+        name,
+        unit,
+        (unsigned long long)hist_percentile(hist, buckets, n, 0.50),
+        name,
+        unit,
+        (unsigned long long)hist_percentile(hist, buckets, n, 0.99),
+        name,
+        unit,
+        (unsigned long long)max,
+        max == buckets - 1 ? "+" : "");
+}
+
+static void stats_frame(
+    TraceStats* st,
+    const RecFileHeader* fh,
+    const Frame* f,
+    const Frame* prev,
+    const uint8_t* prev_screen
+) {
+    const RecFrameHeader* h = f->header;
+    if(!st->frames) {
+        st->first_tick = h->tick_ms;
+        st->first_frame = h->frame;
+    } else {
+        uint32_t interval = h->tick_ms - st->last_tick;
+        hist_add(st->interval_hist, HIST_US / 100, interval);
+        st->late_frames += interval > 40;
+    }
+    st->frames++;
+    st->bytes += f->size;
+    st->last_tick = h->tick_ms;
+    st->last_frame = h->frame;
+
+    uint32_t cpu = fh->cycles_per_us ? fh->cycles_per_us : 1;
+    hist_add(st->step_hist, HIST_US, h->step_cycles / cpu);
+    if(h->raster_cycles) {
+        hist_add(st->raster_hist, HIST_US, h->raster_cycles / cpu);
+        st->raster_frames++;
+    }
+
+    bool same_bodies = prev && prev->header->body_count == h->body_count;
+    if(prev && !same_bodies) st->count_changes++;
+    double moved = 0.0;
+
+    for(size_t i = 0; i < h->body_count; i++) {
+        const RecBody* b = &f->bodies[i];
+        if(b->group >= MAX_GROUPS) continue;
+        GroupStats* g = &st->groups[b->group];
+        if(b->group > st->max_group) st->max_group = b->group;
+
+        g->body_frames++;
+        g->cooldown_frames += (b->flags & REC_BODY_COOLDOWN) != 0;
+        int top = (b->y - b->radius * 4) / 16;
+        int bottom = (b->y + b->radius * 4) / 16;
+        g->visible_frames += bottom >= 0 && top < fh->screen_h;
+
+        if(!same_bodies) continue;
+        const RecBody* p = &prev->bodies[i];
+        if((b->flags & REC_BODY_POPPED) && !(p->flags & REC_BODY_POPPED)) g->pops++;
+        if(b->y - p->y > RESPAWN_JUMP) {
+            g->respawns++;
+            continue;
+        }
+        double dx = (b->x - p->x) / 16.0;
+        double dy = (b->y - p->y) / 16.0;
+        double d = dx * dx + dy * dy;
+        if(d > 0.0) {
+            d = sqrt(d);
+            g->travel += d;
+            moved += d;
+        }
+    }
+
+    if(same_bodies && h->body_count) {
+        double mean = moved / h->body_count;
+        st->diff_frames++;
+        st->diff_sum += mean;
+        if(mean > st->diff_max) st->diff_max = mean;
+    }
+
+    if(f->screen) {
+        st->screens++;
+        if(prev_screen) {
+            uint32_t changed = 0;
+            for(size_t i = 0; i < SCREEN_BYTES(fh); i++) {
+                changed += (uint32_t)__builtin_popcount(f->screen[i] ^ prev_screen[i]);
+            }
+            st->pixel_diff_frames++;
+            st->pixel_diff_sum += changed;
+            if(changed > st->pixel_diff_max) st->pixel_diff_max = changed;
+        }
+    }
+}
+
+static void stats_print(const TraceStats* st, const char* path, const SeekTable* seek) {
+    double seconds = (double)(st->last_tick - st->first_tick) / 1000.0;
+    printf(
+        "trace file=%s frames=%llu first_frame=%lu last_frame=%lu seconds=%.1f bytes=%llu "
+        "resyncs=%llu screens=%llu seek_entries=%zu seek_stride=%lu\n",
+        path,
+        (unsigned long long)st->frames,
+        (unsigned long)st->first_frame,
+        (unsigned long)st->last_frame,
+        seconds,
+        (unsigned long long)st->bytes,
+        (unsigned long long)st->resyncs,
+        (unsigned long long)st->screens,
+        seek->count,
+        (unsigned long)seek->stride);
+
+    for(int g = 0; g <= st->max_group && st->frames; g++) {
+        const GroupStats* gs = &st->groups[g];
+        printf(
+            "group=%d body_frames=%llu visible_pct=%.1f cooldown_pct=%.1f pops=%llu respawns=%llu "
+            "px_per_frame=%.3f\n",
+            g,
+            (unsigned long long)gs->body_frames,
+            gs->body_frames ? 100.0 * (double)gs->visible_frames / (double)gs->body_frames : 0.0,
+            gs->body_frames ? 100.0 * (double)gs->cooldown_frames / (double)gs->body_frames : 0.0,
+            (unsigned long long)gs->pops,
+            (unsigned long long)gs->respawns,
+            gs->body_frames ? gs->travel / (double)gs->body_frames : 0.0);
+    }
+
+    printf(
+        "diff mean_px=%.3f max_px=%.3f count_changes=%llu",
+        st->diff_frames ? st->diff_sum / (double)st->diff_frames : 0.0,
+        st->diff_max,
+        (unsigned long long)st->count_changes);
+    if(st->pixel_diff_frames) {
+        printf(
+            " pixels_mean=%.1f pixels_max=%lu",
+            (double)st->pixel_diff_sum / (double)st->pixel_diff_frames,
+            (unsigned long)st->pixel_diff_max);
+    }
+    printf("\n");
+
+    hist_summary("step", st->step_hist, HIST_US, st->frames, "us");
+    hist_summary("raster", st->raster_hist, HIST_US, st->raster_frames, "us");
+    hist_summary("interval", st->interval_hist, HIST_US / 100, st->frames ? st->frames - 1 : 0, "ms");
+    printf("timing late_frames=%llu\n", (unsigned long long)st->late_frames);
+}
+
+// --- Frame dump -------------------------------------------------------------
+
+static void dump_frame(MappedFile* m, const RecFileHeader* fh, const SeekTable* seek, uint32_t n) {
+    uint64_t off = seek_find(seek, n, fh->header_size);
+    Frame f;
+    while(frame_read(m, fh, off, &f) && f.header->frame < n) {
+        off += f.size;
+    }
+    if(!frame_read(m, fh, off, &f) || f.header->frame != n) {
+        printf("frame=%lu missing\n", (unsigned long)n);
+        return;
+    }
+
+    const RecFrameHeader* h = f.header;
+    uint32_t cpu = fh->cycles_per_us ? fh->cycles_per_us : 1;
+    printf(
+        "frame=%lu offset=%llu tick_ms=%lu step_us=%lu bodies=%u screen=%d\n",
+        (unsigned long)h->frame,
+        (unsigned long long)off,
+        (unsigned long)h->tick_ms,
+        (unsigned long)(h->step_cycles / cpu),
+        (unsigned)h->body_count,
+        f.screen != NULL);
+    for(size_t i = 0; i < h->body_count; i++) {
+        const RecBody* b = &f.bodies[i];
+        printf(
+            "body=%zu group=%u world=%u x=%.2f y=%.2f r=%.2f%s%s%s\n",
+            i,
+            (unsigned)b->group,
+            (unsigned)b->world,
+            b->x / 16.0,
+            b->y / 16.0,
+            b->radius / 4.0,
+            (b->flags & REC_BODY_POPPED) ? " popped" : "",
+            (b->flags & REC_BODY_ANIMATING) ? " animating" : "",
+            (b->flags & REC_BODY_COOLDOWN) ? " cooldown" : "");
+    }
+}
+
+// --- Main -------------------------------------------------------------------
+
+static int usage(void) {
+    fprintf(stderr, "usage: bubble_trace [-f frame]... rec.bsr\n");
+    return 2;
+}
+
+int main(int argc, char** argv) {
+    uint32_t dumps[64];
+    size_t dump_count = 0;
+    int opt;
+    while((opt = getopt(argc, argv, "f:")) != -1) {
+        if(opt != 'f' || dump_count == sizeof(dumps) / sizeof(dumps[0])) return usage();
+        dumps[dump_count++] = (uint32_t)strtoul(optarg, NULL, 10);
+    }
+    if(optind != argc - 1) return usage();
+    const char* path = argv[optind];
+
+    MappedFile m;
+    if(!map_open(&m, path)) {
+        perror(path);
+        return 1;
+    }
+
+    const RecFileHeader* mapped = (const RecFileHeader*)map_at(&m, 0, sizeof(RecFileHeader));
+    if(!mapped || mapped->magic != REC_MAGIC || mapped->version != REC_VERSION ||
+       mapped->header_size < sizeof(RecFileHeader) || SCREEN_BYTES(mapped) > MAX_SCREEN_BYTES) {
+        fprintf(stderr, "%s: not a version %d recording\n", path, REC_VERSION);
+        map_close(&m);
+        return 1;
+    }
+    RecFileHeader fh = *mapped; // the window moves
+
+    static TraceStats st;
+    static SeekTable seek = {.stride = 1};
+    static uint8_t prev_buf[MAX_RECORD];
+    static uint8_t prev_screen[MAX_SCREEN_BYTES];
+    bool have_prev = false;
+    bool have_screen = false;
+    Frame prev = {0};
+
+    uint64_t off = fh.header_size;
+    while(off < m.size) {
+        Frame f;
+        if(!frame_read(&m, &fh, off, &f)) {
+            uint64_t next = frame_resync(&m, &fh, off);
+            if(next < m.size) st.resyncs++;
+            off = next;
+            have_prev = false;
+            continue;
+        }
+
+        seek_add(&seek, st.frames, f.header->frame, off);
+        stats_frame(&st, &fh, &f, have_prev ? &prev : NULL, have_screen ? prev_screen : NULL);
+
+        // Keep a copy of this frame for the next diff; the window may move
+        memcpy(prev_buf, f.header, f.size);
+        prev.header = (const RecFrameHeader*)prev_buf;
+        prev.bodies = (const RecBody*)(prev_buf + sizeof(RecFrameHeader));
+        prev.screen = NULL;
+        prev.size = f.size;
+        have_prev = true;
+        if(f.screen) {
+            memcpy(prev_screen, f.screen, SCREEN_BYTES(&fh));
+            have_screen = true;
+        }
+
+        off += f.size;
+        map_release_before(&m, off);
+    }
+
+    stats_print(&st, path, &seek);
+    for(size_t i = 0; i < dump_count; i++) {
+        dump_frame(&m, &fh, &seek, dumps[i]);
+    }
+
+    map_close(&m);
+    return 0;
+}